@@ -2,282 +2,1061 @@
 
 #include "nlohmann/json.hpp" // Ajoutez du header JSON (https://github.com/nlohmann/json)
 #include "MyRNG.hpp" // Pour la génération de nombres aléatoires
+#include "FMMSolver.hpp" // Bornes de l'ordre des développements
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <set>
 
 using json = nlohmann::json;
 
-APIRest::APIRest(Octree& tree, std::vector<Particle>& particles, SimulationSettings& settings, std::atomic<bool>& paused, std::mutex& mtx)
-    : tree(tree), particles(particles), settings(settings), paused(paused), mtx(mtx), running(false) {}
+APIRest::APIRest(Octree& tree, std::vector<Particle>& particles, HistoryBuffer& history, SnapshotPublisher& snapshots, SimulationSettings& settings, SimulationController& controller, ThreadTopology& topology, SessionManager* sessions)
+    : running(false), streams(0),
+      simulation{tree, particles, history, snapshots, settings, controller, []() { return Particle(); }, true, 0, 0.f},
+      topology(topology), sessions(sessions) {}
+
+// Enregistre path pour la simulation principale et /sessions/{id}path pour chaque session
+void APIRest::route(const char *method, const std::string& path, Handler handler) {
+    bool post = std::string(method) == "POST";
+    httplib::Server::Handler direct = [this, handler](const httplib::Request& req, httplib::Response& res) {
+        (this->*handler)(simulation, req, res);
+    };
+    if (post)
+        server.Post(path, direct);
+    else
+        server.Get(path, direct);
+    if (sessions == nullptr)
+        return;
+    // La requête réveille la session si elle était suspendue
+    httplib::Server::Handler scoped = [this, handler](const httplib::Request& req, httplib::Response& res) {
+        std::shared_ptr<Session> session = sessions->acquire(req.path_params.at("id"));
+        if (!session) {
+            res.status = 404;
+            return;
+        }
+        (this->*handler)(session->context(), req, res);
+    };
+    if (post)
+        server.Post("/sessions/:id" + path, scoped);
+    else
+        server.Get("/sessions/:id" + path, scoped);
+}
 
 void APIRest::start(int port) {
     running = true;
     server_thread = std::thread([this, port]() {
+        // Les threads du serveur, créés depuis celui-ci, héritent de son placement
+        topology.pinApiThread();
 
-        
-        // GET /particles
-        server.Get("/particles", [this](const httplib::Request& req, httplib::Response& res) {
-            std::lock_guard<std::mutex> lock(mtx);
-            int resolution = settings.history_resolution;
-            json j = json::array();
-            for (const auto& p : particles) {
-                // On construit l'historique de positions
-                json history = json::array();
-                const auto& hist = p.getStateHistory();
-                int n = hist.size();
-                //int step = (resolution > 0 && resolution < n) ? std::max(1, n / resolution) : 1;
-                int step = 1;
-                for (int i = 0; i < n; i += step) {
-                    const auto& st = hist[i];
-                    // we check if pas null car peut être déjà pop de l'historique
-                    history.push_back({
-                        {"x", st.position.x},
-                        {"y", st.position.y},
-                        {"z", st.position.z}
-                    });
-                }
-                // Toujours ajouter le dernier point si pas déjà inclus
-                if (n > 0 && (history.empty() || 
-                    (history.back()["x"] != hist.back().position.x ||
-                    history.back()["y"] != hist.back().position.y ||
-                    history.back()["z"] != hist.back().position.z))) {
-                    const auto& st = hist.back();
-                    history.push_back({
-                        {"x", st.position.x},
-                        {"y", st.position.y},
-                        {"z", st.position.z}
-                    });
-                }
-                j.push_back({
-                    {"id", p.getId()},
-                    {"name", p.getName()},
-                    {"x", p.x()},
-                    {"y", p.y()},
-                    {"z", p.z()},
-                    {"vx", p.getVelocity().x},
-                    {"vy", p.getVelocity().y},
-                    {"vz", p.getVelocity().z},
-                    {"mass", p.getMass()},
-                    {"masseVolumique", p.getMasseVolumique()},
-                    {"colorHex", p.getColorHex()},
-                    {"history", history}
+        // Servi depuis l'instantané publié : aucun verrou, la simulation n'est jamais bloquée
+        route("GET", "/particles", &APIRest::getParticles);
+        route("GET", "/particles.bin", &APIRest::getParticlesBinary);
+        route("GET", "/query/box", &APIRest::queryBox);
+        route("GET", "/query/radius", &APIRest::queryRadius);
+        route("GET", "/query/knn", &APIRest::queryNearest);
+        route("GET", "/lod", &APIRest::getLevelOfDetail);
+        route("POST", "/rewind", &APIRest::postRewind);
+        route("POST", "/reset", &APIRest::postReset);
+        route("POST", "/particles", &APIRest::postParticles);
+        route("GET", "/settings", &APIRest::getSettings);
+        route("POST", "/settings", &APIRest::postSettings);
+        route("POST", "/pause", &APIRest::postPause);
+        route("POST", "/resume", &APIRest::postResume);
+
+        // POST /stop
+        // Appliqué à la prochaine frontière de pas : la boucle de simulation se termine ensuite
+        server.Post("/stop", [this](const httplib::Request&, httplib::Response& res) {
+            simulation.controller.submit([this]() {
+                simulation.settings.closed = true;
+                simulation.snapshots.publishSettings(simulation.settings);
+                simulation.controller.setStopped();
+            });
+            res.status = 200;
+        });
+
+        // GET /stream
+        server.Get("/stream", [this](const httplib::Request& req, httplib::Response& res) {
+            stream(req, res, [this](std::shared_ptr<Session>&) { return &simulation; });
+        });
+
+        if (sessions != nullptr)
+            routeSessions();
+
+        server.listen("0.0.0.0", port);
+    });
+}
+
+// Envoie la réponse key de l'instantané, encodée une seule fois pour tous les clients (SnapshotCache).
+// L'ETag est une empreinte du corps : If-None-Match reçoit 304 tant que le contenu n'a pas changé,
+// même d'une publication à l'autre. Avec zlib (make ZLIB=1), la variante gzip est compressée une seule fois.
+static void sendCached(const httplib::Request& req, httplib::Response& res, SnapshotCache& cache,
+                       const std::string& key, const char *contentType, const std::function<std::string()>& encode) {
+    std::shared_ptr<const std::string> body = cache.get(key, encode);
+    std::string etag = *cache.get(key + "#etag", [&body]() {
+        char text[24];
+        std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(std::hash<std::string>()(*body)));
+        return std::string(text);
+    });
+    bool gzip = false;
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+    // Le JSON seulement : les colonnes binaires se compressent mal
+    res.set_header("Vary", "Accept-Encoding");
+    gzip = std::string(contentType) == "application/json" && req.get_header_value("Accept-Encoding").find("gzip") != std::string::npos;
+#endif
+    // Une étiquette par représentation
+    etag = "\"" + etag + (gzip ? "-gzip\"" : "\"");
+    res.set_header("ETag", etag);
+    const std::string match = req.get_header_value("If-None-Match");
+    if (match == "*" || match.find(etag) != std::string::npos) {
+        res.status = 304;
+        return;
+    }
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+    if (gzip) {
+        std::shared_ptr<const std::string> compressed = cache.get(key + "#gzip", [&body]() {
+            std::string out;
+            httplib::detail::gzip_compressor().compress(body->data(), body->size(), true,
+                [&out](const char *data, std::size_t length) {
+                    out.append(data, length);
+                    return true;
                 });
-            }
-            res.set_content(j.dump(), "application/json");
+            return out;
         });
+        res.set_header("Content-Encoding", "gzip");
+        // Type avec paramètre : httplib ne reconnaît pas le type et ne recompresse pas le corps
+        res.set_content(*compressed, std::string(contentType) + "; charset=utf-8");
+        return;
+    }
+#endif
+    res.set_content(*body, contentType);
+}
+
+// Champs d'une particule dans GET /particles (fields=), dans l'ordre de la réponse
+static const char *PARTICLE_FIELDS[] = {
+    "id", "name", "x", "y", "z", "vx", "vy", "vz", "mass", "masseVolumique", "colorHex", "history"
+};
+static const int PARTICLE_FIELD_COUNT = sizeof(PARTICLE_FIELDS) / sizeof(PARTICLE_FIELDS[0]);
+
+// Sélection demandée à GET /particles
+struct ParticleQuery {
+    unsigned fields;               // Bit i : PARTICLE_FIELDS[i] est renvoyé
+    std::vector<std::size_t> rows; // Indices des particules renvoyées, dans l'ordre
+    std::size_t total;             // Particules retenues par ids, avant pagination
+    std::size_t history;           // Nombre de trames d'historique renvoyées (les plus récentes)
+    std::string selection;         // Forme canonique de ids, offset et limit (clé du cache des réponses)
+};
+
+// Découpe une liste séparée par des virgules
+static std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::size_t begin = 0;
+    while (begin <= list.size()) {
+        std::size_t end = list.find(',', begin);
+        if (end == std::string::npos)
+            end = list.size();
+        if (end > begin)
+            items.push_back(list.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return items;
+}
+
+// Entier positif ou nul écrit en entier (false sinon)
+static bool parseCount(const std::string& text, std::size_t& value) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+    try {
+        value = std::stoull(text);
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+// Lit fields=, ids=, offset=, limit= et history= ; false si un paramètre est invalide
+static bool parseParticleQuery(const httplib::Request& req, const std::vector<ParticleInfo>& info, std::size_t n, ParticleQuery& query) {
+    query.fields = (1u << PARTICLE_FIELD_COUNT) - 1;
+    if (req.has_param("fields")) {
+        query.fields = 0;
+        for (const std::string& name : splitList(req.get_param_value("fields"))) {
+            int f = 0;
+            while (f < PARTICLE_FIELD_COUNT && name != PARTICLE_FIELDS[f])
+                f++;
+            if (f == PARTICLE_FIELD_COUNT)
+                return false;
+            query.fields |= 1u << f;
+        }
+    }
+
+    query.history = std::numeric_limits<std::size_t>::max();
+    if (req.has_param("history")) {
+        const std::string history = req.get_param_value("history");
+        if (history == "none")
+            query.history = 0;
+        else if (history == "last")
+            query.history = 1;
+        else if (history != "all" && !parseCount(history, query.history))
+            return false;
+    }
 
-        server.Post("/rewind", [this](const httplib::Request& req, httplib::Response& res) {
-            std::lock_guard<std::mutex> lock(mtx);
-            auto j = json::parse(req.body);
-            float rewind_delta = j.value("rewind_time", 5.0f);
-            float rewind_time = std::max(0.f, settings.current_time - rewind_delta);
-            for (auto& p : particles) {
-                p.restoreState(rewind_time, mtx); // Restore state at rewind_time
+    std::vector<std::size_t> rows;
+    if (req.has_param("ids")) {
+        std::set<int> ids;
+        for (const std::string& item : splitList(req.get_param_value("ids"))) {
+            try {
+                std::size_t used;
+                ids.insert(std::stoi(item, &used));
+                if (used != item.size())
+                    return false;
+            } catch (...) {
+                return false;
             }
-            settings.current_time = rewind_time;
-            res.status = 200;
+        }
+        // Seuls les identifiants existants comptent dans la clé
+        query.selection = "ids=";
+        for (std::size_t i = 0; i < n; i++) {
+            if (ids.count(info[i].id)) {
+                rows.push_back(i);
+                query.selection += std::to_string(info[i].id) + ",";
+            }
+        }
+    } else {
+        rows.resize(n);
+        for (std::size_t i = 0; i < n; i++)
+            rows[i] = i;
+    }
+    query.total = rows.size();
+
+    std::size_t offset = 0, limit = rows.size();
+    if (req.has_param("offset") && !parseCount(req.get_param_value("offset"), offset))
+        return false;
+    if (req.has_param("limit") && !parseCount(req.get_param_value("limit"), limit))
+        return false;
+    offset = std::min(offset, rows.size());
+    limit = std::min(limit, rows.size() - offset);
+    query.rows.assign(rows.begin() + offset, rows.begin() + offset + limit);
+    query.selection += "&offset=" + std::to_string(offset) + "&limit=" + std::to_string(limit);
+    return true;
+}
+
+// Valeurs d'une colonne aux lignes retenues
+static std::vector<float> selectRows(const ArenaVector<float>& column, const std::vector<std::size_t>& rows) {
+    std::vector<float> values(rows.size());
+    for (std::size_t r = 0; r < rows.size(); r++)
+        values[r] = column[rows[r]];
+    return values;
+}
+
+// Trames d'historique publiées après since, en colonnes, et vitesses courantes :
+// {"version", "since", "current_time", "history_length", "frames": [{"version", "time", "x", "y", "z"}], "vx", "vy", "vz"}
+// Les colonnes suivent les lignes retenues par la requête.
+static json deltaJson(const Snapshot& snapshot, uint64_t since, std::size_t n, const std::vector<std::size_t>& rows) {
+    json frames = json::array();
+    const HistoryView& history = *snapshot.history;
+    const std::vector<uint64_t>& versions = *snapshot.frameVersions;
+    for (std::size_t k = 0; k < history.size(); k++) {
+        const HistoryFrame& frame = *history[k];
+        if (versions[k] <= since || frame.size() < n)
+            continue;
+        frames.push_back({
+            {"version", versions[k]},
+            {"time", frame.time},
+            {"x", selectRows(frame.x, rows)},
+            {"y", selectRows(frame.y, rows)},
+            {"z", selectRows(frame.z, rows)}
         });
+    }
+    const HistoryFrame& state = *snapshot.state;
+    return {
+        {"version", snapshot.version},
+        {"since", since},
+        {"current_time", snapshot.settings.current_time},
+        {"history_length", history.size()},
+        {"frames", frames},
+        {"vx", selectRows(state.vx, rows)},
+        {"vy", selectRows(state.vy, rows)},
+        {"vz", selectRows(state.vz, rows)}
+    };
+}
 
-        server.Post("/reset", [this](const httplib::Request&, httplib::Response& res) {
-            std::lock_guard<std::mutex> lock(mtx);
+// Tableau JSON des particules retenues par query
+static std::string particlesJson(const Snapshot& snapshot, const ParticleQuery& query) {
+    const std::vector<ParticleInfo>& info = *snapshot.info;
+    const HistoryFrame& state = *snapshot.state;
+    const HistoryView& history = *snapshot.history;
+    std::size_t firstFrame = history.size() - std::min(query.history, history.size());
+    json j = json::array();
+    for (std::size_t i : query.rows) {
+        json p = json::object();
+        for (int f = 0; f < PARTICLE_FIELD_COUNT; f++) {
+            if (!(query.fields & (1u << f)))
+                continue;
+            switch (f) {
+                case 0: p["id"] = info[i].id; break;
+                case 1: p["name"] = info[i].name; break;
+                case 2: p["x"] = state.x[i]; break;
+                case 3: p["y"] = state.y[i]; break;
+                case 4: p["z"] = state.z[i]; break;
+                case 5: p["vx"] = state.vx[i]; break;
+                case 6: p["vy"] = state.vy[i]; break;
+                case 7: p["vz"] = state.vz[i]; break;
+                case 8: p["mass"] = info[i].mass; break;
+                case 9: p["masseVolumique"] = info[i].masseVolumique; break;
+                case 10: p["colorHex"] = info[i].colorHex; break;
+                case 11: {
+                    // On construit l'historique de positions
+                    json positions = json::array();
+                    for (std::size_t k = firstFrame; k < history.size(); k++) {
+                        const HistoryFrame& frame = *history[k];
+                        if (i >= frame.size())
+                            continue;
+                        positions.push_back({
+                            {"x", frame.x[i]},
+                            {"y", frame.y[i]},
+                            {"z", frame.z[i]}
+                        });
+                    }
+                    p["history"] = positions;
+                    break;
+                }
+            }
+        }
+        j.push_back(p);
+    }
+    return j.dump();
+}
 
-            // Réinitialiser toutes les particules
-            for (auto& p : particles) {
-                p = Particle(); // Remet la particule à un état neuf, random (si tu veux les remettre à des positions identiques à l'initialisation)
+// GET /particles[?since=<version>][&fields=x,y,z,...][&ids=1,2,...][&offset=o][&limit=l][&history=none|last|N|all]
+// Version publiée dans l'en-tête X-Snapshot-Version. Avec since : 304 si les particules n'ont pas changé,
+// les seules trames d'historique ajoutées depuis (delta) si since est postérieur à la dernière discontinuité,
+// l'état complet sinon.
+// fields, history : champs et trames d'historique (les N plus récentes) de l'état complet.
+// ids, offset, limit : particules renvoyées (état complet et delta) ; X-Total-Count avant pagination.
+void APIRest::getParticles(SimulationContext& sim, const httplib::Request& req, httplib::Response& res) {
+    SnapshotPublisher::Reader snapshot(sim.snapshots);
+    const std::vector<ParticleInfo>& info = *snapshot->info;
+    const HistoryFrame& state = *snapshot->state;
+    std::size_t n = std::min(info.size(), state.size());
+    ParticleQuery query;
+    if (!parseParticleQuery(req, info, n, query)) {
+        res.status = 400;
+        return;
+    }
+    res.set_header("X-Snapshot-Version", std::to_string(snapshot->version));
+    res.set_header("X-Total-Count", std::to_string(query.total));
+    if (req.has_param("since")) {
+        uint64_t since;
+        try {
+            since = std::stoull(req.get_param_value("since"));
+        } catch (...) {
+            res.status = 400;
+            return;
+        }
+        if (since >= snapshot->baseVersion && since <= snapshot->version) {
+            if (since >= snapshot->stateVersion) {
+                res.status = 304;
+                return;
             }
-            // Reset settings de temps
-            settings.current_time = 0.f;
-            // Effacer l'octree
-            tree.clear();
-            // Re-créer l'octree avec les bornes initiales
-            tree.updateAttributes(
-                settings.MIN_X, settings.MIN_Y, settings.MIN_Z,
-                std::abs(settings.MAX_X - settings.MIN_X), 
-                std::abs(settings.MAX_Y - settings.MIN_Y), 
-                std::abs(settings.MAX_Z - settings.MIN_Z),
-                1
-            );
+            std::string key = "particles?since=" + std::to_string(since) + "&" + query.selection;
+            sendCached(req, res, *snapshot->cache, key, "application/json", [&]() {
+                return deltaJson(*snapshot, since, n, query.rows).dump();
+            });
+            return;
+        }
+    }
+    // État complet : le même pour toutes les valeurs de since périmées ; clé tirée de la requête interprétée
+    // (les paramètres inconnus, comme un anti-cache _=<n>, ne créent pas de nouvelle entrée)
+    std::size_t frames = std::min(query.history, snapshot->history->size());
+    std::string key = "particles?fields=" + std::to_string(query.fields) + "&history=" + std::to_string(frames) + "&" + query.selection;
+    sendCached(req, res, *snapshot->cache, key, "application/json", [&]() {
+        return particlesJson(*snapshot, query);
+    });
+}
 
-            paused = true; // Peut-être utile de mettre la simu en pause après reset
+// Les colonnes sont recopiées telles quelles : le format binaire est petit-boutiste
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "GET /particles.bin suppose une machine petit-boutiste");
 
-            res.status = 200;
+// Corps de GET /particles.bin
+static std::string particlesBinary(const Snapshot& snapshot) {
+    const std::vector<ParticleInfo>& info = *snapshot.info;
+    const HistoryFrame& state = *snapshot.state;
+    uint32_t n = static_cast<uint32_t>(std::min(info.size(), state.size()));
+    const std::size_t headerSize = 24;
+    const std::size_t column = n * sizeof(float);
+    std::string body(headerSize + 8 * column, '\0');
+    char *out = &body[0];
+    uint64_t version = snapshot.version;
+    float time = snapshot.settings.current_time;
+    std::memcpy(out, "NBP1", 4);
+    std::memcpy(out + 4, &n, 4);
+    std::memcpy(out + 8, &version, 8);
+    std::memcpy(out + 16, &time, 4);
+    out += headerSize;
+    int32_t *ids = reinterpret_cast<int32_t*>(out);
+    float *mass = reinterpret_cast<float*>(out + 7 * column);
+    for (uint32_t i = 0; i < n; i++) {
+        ids[i] = info[i].id;
+        mass[i] = info[i].mass;
+    }
+    const ArenaVector<float>* columns[6] = {&state.x, &state.y, &state.z, &state.vx, &state.vy, &state.vz};
+    for (int c = 0; c < 6; c++)
+        std::memcpy(out + (c + 1) * column, columns[c]->data(), column);
+    return body;
+}
+
+// GET /particles.bin
+// État courant sans historique, en colonnes float32 (ou int32) petit-boutistes :
+//   en-tête de 24 octets : "NBP1", uint32 n, uint64 version de l'instantané, float32 current_time, uint32 0
+//   puis id[n] (int32), x[n], y[n], z[n], vx[n], vy[n], vz[n], mass[n] (float32)
+// Tous les tableaux commencent sur un multiple de 4 octets (vues Float32Array directes côté navigateur).
+void APIRest::getParticlesBinary(SimulationContext& sim, const httplib::Request& req, httplib::Response& res) {
+    SnapshotPublisher::Reader snapshot(sim.snapshots);
+    sendCached(req, res, *snapshot->cache, "particles.bin", "application/octet-stream", [&snapshot]() {
+        return particlesBinary(*snapshot);
+    });
+}
+
+// Point "x,y,z" (ou "x,y" en 2D, z = 0) d'un paramètre de requête ; false si absent ou invalide
+static bool parsePoint(const httplib::Request& req, const char *name, Vector3D& point) {
+    if (!req.has_param(name))
+        return false;
+    std::vector<std::string> items = splitList(req.get_param_value(name));
+    if (items.size() < 2 || items.size() > 3)
+        return false;
+    float coords[3] = {0.f, 0.f, 0.f};
+    for (std::size_t c = 0; c < items.size(); c++) {
+        try {
+            std::size_t used;
+            coords[c] = std::stof(items[c], &used);
+            if (used != items[c].size())
+                return false;
+        } catch (...) {
+            return false;
+        }
+    }
+    point = Vector3D(coords[0], coords[1], coords[2]);
+    return true;
+}
+
+// Réponse des requêtes spatiales : {"version", "count", "particles": [{"id", "x", "y", "z", "vx", "vy", "vz"[, "distance"]}]}
+// distances : distances au carré, alignées sur found (vide : pas de champ distance)
+static json queryJson(const Snapshot& snapshot, const std::vector<uint32_t>& found, const std::vector<float>& distances) {
+    const std::vector<ParticleInfo>& info = *snapshot.info;
+    const HistoryFrame& state = *snapshot.state;
+    json particles = json::array();
+    for (std::size_t r = 0; r < found.size(); r++) {
+        uint32_t i = found[r];
+        if (i >= info.size())
+            continue;
+        json p = {
+            {"id", info[i].id},
+            {"x", state.x[i]},
+            {"y", state.y[i]},
+            {"z", state.z[i]},
+            {"vx", state.vx[i]},
+            {"vy", state.vy[i]},
+            {"vz", state.vz[i]}
+        };
+        if (!distances.empty())
+            p["distance"] = std::sqrt(distances[r]);
+        particles.push_back(p);
+    }
+    return {
+        {"version", snapshot.version},
+        {"count", particles.size()},
+        {"particles", particles}
+    };
+}
+
+// Les requêtes spatiales parcourent l'octree des positions de l'instantané publié,
+// construit au premier appel pour cet instantané et partagé par les suivants
+
+// GET /query/box?min=x,y,z&max=x,y,z
+// Particules dans la boîte [min, max]
+void APIRest::queryBox(SimulationContext& sim, const httplib::Request& req, httplib::Response& res) {
+    Vector3D min, max;
+    if (!parsePoint(req, "min", min) || !parsePoint(req, "max", max)) {
+        res.status = 400;
+        return;
+    }
+    SnapshotPublisher::Reader snapshot(sim.snapshots);
+    std::vector<uint32_t> found;
+    snapshot->cache->tree(*snapshot->state, *snapshot->info)->queryBox(min, max, found);
+    res.set_header("X-Snapshot-Version", std::to_string(snapshot->version));
+    res.set_content(queryJson(*snapshot, found, std::vector<float>()).dump(), "application/json");
+}
+
+// GET /query/radius?center=x,y,z&r=<rayon>
+// Particules à une distance inférieure ou égale à r du centre, avec leur distance
+void APIRest::queryRadius(SimulationContext& sim, const httplib::Request& req, httplib::Response& res) {
+    Vector3D center;
+    float radius;
+    try {
+        const std::string text = req.get_param_value("r");
+        std::size_t used;
+        radius = std::stof(text, &used);
+        if (used != text.size())
+            throw std::invalid_argument(text);
+    } catch (...) {
+        res.status = 400;
+        return;
+    }
+    if (!parsePoint(req, "center", center) || !(radius >= 0.f)) {
+        res.status = 400;
+        return;
+    }
+    SnapshotPublisher::Reader snapshot(sim.snapshots);
+    std::vector<uint32_t> found;
+    snapshot->cache->tree(*snapshot->state, *snapshot->info)->queryRadius(center, radius, found);
+    const HistoryFrame& state = *snapshot->state;
+    std::vector<float> distances(found.size());
+    for (std::size_t r = 0; r < found.size(); r++) {
+        float dx = state.x[found[r]] - center.x, dy = state.y[found[r]] - center.y, dz = state.z[found[r]] - center.z;
+        distances[r] = dx * dx + dy * dy + dz * dz;
+    }
+    res.set_header("X-Snapshot-Version", std::to_string(snapshot->version));
+    res.set_content(queryJson(*snapshot, found, distances).dump(), "application/json");
+}
+
+// GET /query/knn?center=x,y,z&k=<nombre>
+// Les k particules les plus proches du centre, de la plus proche à la plus lointaine
+void APIRest::queryNearest(SimulationContext& sim, const httplib::Request& req, httplib::Response& res) {
+    Vector3D center;
+    std::size_t k;
+    if (!parsePoint(req, "center", center) || !parseCount(req.get_param_value("k"), k)) {
+        res.status = 400;
+        return;
+    }
+    SnapshotPublisher::Reader snapshot(sim.snapshots);
+    std::vector<std::pair<float, uint32_t> > nearest = snapshot->cache->tree(*snapshot->state, *snapshot->info)->nearest(center, k);
+    std::vector<uint32_t> found(nearest.size());
+    std::vector<float> distances(nearest.size());
+    for (std::size_t r = 0; r < nearest.size(); r++) {
+        distances[r] = nearest[r].first;
+        found[r] = nearest[r].second;
+    }
+    res.set_header("X-Snapshot-Version", std::to_string(snapshot->version));
+    res.set_content(queryJson(*snapshot, found, distances).dump(), "application/json");
+}
+
+// Budget par défaut de GET /lod sans depth ni budget
+static const std::size_t LOD_DEFAULT_BUDGET = 4096;
+
+// Vue agrégée en colonnes : {"version", "current_time", "total",
+//   "cells": {"x", "y", "z", "mass", "count", "min_x", "min_y", "min_z", "width", "height", "depth"},
+//   "particles": {"id", "x", "y", "z", "mass"}}
+static std::string lodJson(const Snapshot& snapshot, const std::vector<LodCell>& cells, const std::vector<uint32_t>& found) {
+    json c = json::object();
+    const char *cellColumns[] = {"x", "y", "z", "mass", "min_x", "min_y", "min_z", "width", "height", "depth"};
+    for (const char *column : cellColumns)
+        c[column] = json::array();
+    c["count"] = json::array();
+    for (const LodCell& cell : cells) {
+        c["x"].push_back(cell.centerOfMass.x);
+        c["y"].push_back(cell.centerOfMass.y);
+        c["z"].push_back(cell.centerOfMass.z);
+        c["mass"].push_back(cell.mass);
+        c["count"].push_back(cell.count);
+        c["min_x"].push_back(cell.min.x);
+        c["min_y"].push_back(cell.min.y);
+        c["min_z"].push_back(cell.min.z);
+        c["width"].push_back(cell.size.x);
+        c["height"].push_back(cell.size.y);
+        c["depth"].push_back(cell.size.z);
+    }
+    const std::vector<ParticleInfo>& info = *snapshot.info;
+    const HistoryFrame& state = *snapshot.state;
+    std::vector<int> ids;
+    std::vector<float> x, y, z, mass;
+    for (uint32_t i : found) {
+        ids.push_back(info[i].id);
+        x.push_back(state.x[i]);
+        y.push_back(state.y[i]);
+        z.push_back(state.z[i]);
+        mass.push_back(info[i].mass);
+    }
+    json j = {
+        {"version", snapshot.version},
+        {"current_time", snapshot.settings.current_time},
+        {"total", std::min(info.size(), state.size())},
+        {"cells", c},
+        {"particles", {{"id", ids}, {"x", x}, {"y", y}, {"z", z}, {"mass", mass}}}
+    };
+    return j.dump();
+}
+
+// GET /lod[?depth=d | ?budget=K][&sparse=s]
+// Vue d'ensemble bornée de l'état publié, tirée de l'octree des positions de l'instantané : centres de masse,
+// masses et volumes des nœuds à la profondeur d (ou d'au plus K éléments, les nœuds les plus peuplés
+// étant ouverts en premier), et particules individuelles des nœuds d'au plus s particules (1 par défaut).
+void APIRest::getLevelOfDetail(SimulationContext& sim, const httplib::Request& req, httplib::Response& res) {
+    std::size_t depth = 0, budget = LOD_DEFAULT_BUDGET, sparse = 1;
+    bool byDepth = req.has_param("depth");
+    if ((byDepth && req.has_param("budget"))
+        || (byDepth && !parseCount(req.get_param_value("depth"), depth))
+        || (req.has_param("budget") && (!parseCount(req.get_param_value("budget"), budget) || budget == 0))
+        || (req.has_param("sparse") && !parseCount(req.get_param_value("sparse"), sparse))) {
+        res.status = 400;
+        return;
+    }
+    depth = std::min<std::size_t>(depth, 64);
+    sparse = std::min<std::size_t>(sparse, std::numeric_limits<uint32_t>::max());
+    SnapshotPublisher::Reader snapshot(sim.snapshots);
+    res.set_header("X-Snapshot-Version", std::to_string(snapshot->version));
+    std::string key = byDepth ? "lod?depth=" + std::to_string(depth) : "lod?budget=" + std::to_string(budget);
+    key += "&sparse=" + std::to_string(sparse);
+    sendCached(req, res, *snapshot->cache, key, "application/json", [&]() {
+        std::shared_ptr<const Octree> tree = snapshot->cache->tree(*snapshot->state, *snapshot->info, true);
+        std::vector<LodCell> cells;
+        std::vector<uint32_t> found;
+        if (byDepth)
+            tree->levelOfDetail(static_cast<int>(depth), static_cast<uint32_t>(sparse), cells, found);
+        else
+            tree->levelOfDetailBudget(budget, static_cast<uint32_t>(sparse), cells, found);
+        return lodJson(*snapshot, cells, found);
+    });
+}
+
+// POST /rewind
+void APIRest::postRewind(SimulationContext& sim, const httplib::Request& req, httplib::Response& res) {
+    try {
+        auto j = json::parse(req.body);
+        float rewind_delta = j.value("rewind_time", 5.0f);
+        sim.controller.submit([&sim, rewind_delta]() {
+            float rewind_time = std::max(0.f, sim.settings.current_time - rewind_delta);
+            sim.history.rewind(sim.particles, rewind_time); // Restore state at rewind_time
+            sim.settings.current_time = rewind_time;
+            sim.snapshots.publishParticles(sim.particles, sim.settings, sim.history);
         });
-        
+        res.status = 200;
+    } catch (...) {
+        res.status = 400;
+    }
+}
 
-        // POST /particles
-        server.Post("/particles", [this](const httplib::Request& req, httplib::Response& res) {
-            std::lock_guard<std::mutex> lock(mtx);
-            try {
-                auto j = json::parse(req.body);
-                printf("Received particles data: %s\n", j.dump().c_str());
-                Particle::id_counter = 0;
-                particles.clear();
-                particles.reserve(j.size());
-
-                float min_x = std::numeric_limits<float>::max();
-                float min_y = std::numeric_limits<float>::max();
-                float min_z = std::numeric_limits<float>::max();
-                float max_x = std::numeric_limits<float>::lowest();
-                float max_y = std::numeric_limits<float>::lowest();
-                float max_z = std::numeric_limits<float>::lowest();
-
-                for (const auto& jp : j) {
-                    float x = jp.value("x", 0.f);
-                    float y = jp.value("y", 0.f);
-                    float z = jp.value("z", 0.f);
-                    float mass = jp.value("mass", 1.f);
-                    float masseVol = jp.value("masseVolumique", 1.f);
-                    std::string colorHex = jp.value("colorHex", "");
-                    std::string nom = jp.value("name", ""); // Récupère le nom s'il existe, sinon chaîne vide
-
-                    Particle p(x, y, z, jp.value("vx", 0.f), jp.value("vy", 0.f), jp.value("vz", 0.f), mass, masseVol, colorHex);
-                    if (!nom.empty()) p.setName(nom); // Ajoute le nom si présent
-                    particles.push_back(p);
-
-                    min_x = std::min(min_x, x);
-                    min_y = std::min(min_y, y);
-                    min_z = std::min(min_z, z);
-                    max_x = std::max(max_x, x);
-                    max_y = std::max(max_y, y);
-                    max_z = std::max(max_z, z);
-                }
+// POST /reset
+void APIRest::postReset(SimulationContext& sim, const httplib::Request&, httplib::Response& res) {
+    sim.controller.submit([&sim]() {
+        // Réinitialiser toutes les particules
+        for (auto& p : sim.particles) {
+            p = sim.randomParticle(); // Remet la particule à un état neuf, random (si tu veux les remettre à des positions identiques à l'initialisation)
+        }
+        sim.history.clear();
+        // Reset settings de temps
+        sim.settings.current_time = 0.f;
+        // Effacer l'octree
+        sim.tree.clear();
+        // Re-créer l'octree avec les bornes initiales
+        sim.tree.updateAttributes(
+            sim.settings.MIN_X, sim.settings.MIN_Y, sim.settings.MIN_Z,
+            std::abs(sim.settings.MAX_X - sim.settings.MIN_X), 
+            std::abs(sim.settings.MAX_Y - sim.settings.MIN_Y), 
+            std::abs(sim.settings.MAX_Z - sim.settings.MIN_Z),
+            1
+        );
 
-                // Calculate bounding cube
-                float extent_x = max_x - min_x;
-                float extent_y = max_y - min_y;
-                float extent_z = max_z - min_z;
-                float max_extent = std::max({extent_x, extent_y, extent_z});
-                float margin = 0.025f * max_extent;
-                float cube_size = max_extent + 2.f * margin;
-
-                float center_x = (min_x + max_x) / 2.f;
-                float center_y = (min_y + max_y) / 2.f;
-                float center_z = (min_z + max_z) / 2.f;
-
-                float origin_x = center_x - cube_size / 2.f;
-                float origin_y = center_y - cube_size / 2.f;
-                float origin_z = center_z - cube_size / 2.f;
-
-                // Update octree with cubic box
-                tree.clear();
-                tree.updateAttributes(
-                    origin_x, origin_y, origin_z,
-                    cube_size, cube_size, cube_size,
-                    1 // Capacity of the octree
-                );
+        sim.controller.setPaused(true); // Peut-être utile de mettre la simu en pause après reset
+        sim.snapshots.publishParticles(sim.particles, sim.settings, sim.history);
+    });
+    res.status = 200;
+}
+
+// POST /particles
+void APIRest::postParticles(SimulationContext& sim, const httplib::Request& req, httplib::Response& res) {
+    try {
+        auto j = json::parse(req.body);
+        if (sim.maxParticles > 0 && j.size() > static_cast<std::size_t>(sim.maxParticles)) {
+            res.status = 413;
+            return;
+        }
+        if (sim.primary)
+            printf("Received particles data: %s\n", j.dump().c_str());
+        sim.controller.submit([&]() {
+            // Construites à part : une entrée invalide laisse la simulation (et le compteur d'identifiants) intacte
+            std::vector<Particle> loaded;
+            loaded.reserve(j.size());
+
+            float min_x = std::numeric_limits<float>::max();
+            float min_y = std::numeric_limits<float>::max();
+            float min_z = std::numeric_limits<float>::max();
+            float max_x = std::numeric_limits<float>::lowest();
+            float max_y = std::numeric_limits<float>::lowest();
+            float max_z = std::numeric_limits<float>::lowest();
+
+            for (const auto& jp : j) {
+                float x = jp.value("x", 0.f);
+                float y = jp.value("y", 0.f);
+                float z = jp.value("z", 0.f);
+                float mass = jp.value("mass", 1.f);
+                float masseVol = jp.value("masseVolumique", 1.f);
+                std::string colorHex = jp.value("colorHex", "");
+                std::string nom = jp.value("name", ""); // Récupère le nom s'il existe, sinon chaîne vide
+
+                Particle p(x, y, z, jp.value("vx", 0.f), jp.value("vy", 0.f), jp.value("vz", 0.f), mass, masseVol, colorHex);
+                if (!nom.empty()) p.setName(nom); // Ajoute le nom si présent
+                p.setId(static_cast<int>(loaded.size())); // Identifiants 0..n-1 dans l'ordre du fichier
+                loaded.push_back(p);
+
+                min_x = std::min(min_x, x);
+                min_y = std::min(min_y, y);
+                min_z = std::min(min_z, z);
+                max_x = std::max(max_x, x);
+                max_y = std::max(max_y, y);
+                max_z = std::max(max_z, z);
+            }
 
-                // Update simulation settings
-                settings.nb_particles = particles.size();
-                float min_all = std::min({origin_x, origin_y, origin_z});
-                float max_all = std::max({origin_x + cube_size, origin_y + cube_size, origin_z + cube_size});
-                // Round down min_all and round up max_all to the nearest integer
-                settings.MIN_X = settings.MIN_Y = settings.MIN_Z = std::floor(min_all);
-                settings.MAX_X = settings.MAX_Y = settings.MAX_Z = std::ceil(max_all);
-                settings.current_time = 0.f;
-                // We update Max Min 
+            sim.particles.swap(loaded);
+            // Numérotation reprise après les particules chargées (les sessions ont leurs propres identifiants)
+            if (sim.primary)
+                Particle::id_counter = static_cast<int>(sim.particles.size());
+            sim.history.clear();
+
+            // Calculate bounding cube
+            float extent_x = max_x - min_x;
+            float extent_y = max_y - min_y;
+            float extent_z = max_z - min_z;
+            float max_extent = std::max({extent_x, extent_y, extent_z});
+            float margin = 0.025f * max_extent;
+            float cube_size = max_extent + 2.f * margin;
+
+            float center_x = (min_x + max_x) / 2.f;
+            float center_y = (min_y + max_y) / 2.f;
+            float center_z = (min_z + max_z) / 2.f;
+
+            float origin_x = center_x - cube_size / 2.f;
+            float origin_y = center_y - cube_size / 2.f;
+            float origin_z = center_z - cube_size / 2.f;
+
+            // Update octree with cubic box
+            sim.tree.clear();
+            sim.tree.updateAttributes(
+                origin_x, origin_y, origin_z,
+                cube_size, cube_size, cube_size,
+                1 // Capacity of the octree
+            );
+
+            // Update simulation settings
+            SimulationSettings& settings = sim.settings;
+            settings.nb_particles = sim.particles.size();
+            float min_all = std::min({origin_x, origin_y, origin_z});
+            float max_all = std::max({origin_x + cube_size, origin_y + cube_size, origin_z + cube_size});
+            // Round down min_all and round up max_all to the nearest integer
+            settings.MIN_X = settings.MIN_Y = settings.MIN_Z = std::floor(min_all);
+            settings.MAX_X = settings.MAX_Y = settings.MAX_Z = std::ceil(max_all);
+            settings.current_time = 0.f;
+            // We update Max Min (bornes globales : simulation principale seulement)
+            if (sim.primary) {
                 MyRNG::updateMaxMin(
                         settings.MIN_X, settings.MAX_X, settings.MIN_Y, 
                         settings.MAX_Y, settings.MIN_Z, settings.MAX_Z
                 );
-                paused = true;
-                res.status = 200;
-
-            } catch (...) {
-                res.status = 400;
             }
+            sim.controller.setPaused(true);
+            sim.snapshots.publishParticles(sim.particles, settings, sim.history);
         });
+        res.status = 200;
 
-        // GET /settings
-        server.Get("/settings", [this](const httplib::Request&, httplib::Response& res) {
-            //std::lock_guard<std::mutex> lock(mtx);
-            json j = {
-                {"t_total", settings.t_total},
-                {"dt", settings.dt},
-                {"nb_particles", settings.nb_particles},
-                {"paused", paused.load()},
-                {"current_time", settings.current_time},
-                {"rewind_max_history", settings.rewind_max_history},
-                {"closed", settings.closed},
-                {"MAX_Y", settings.MAX_Y},
-                {"MAX_X", settings.MAX_X},
-                {"MAX_Z", settings.MAX_Z},
-                {"MIN_Y", settings.MIN_Y},
-                {"MIN_X", settings.MIN_X},
-                {"MIN_Z", settings.MIN_Z},
-                {"history_resolution", settings.history_resolution}
-            };
-            res.set_content(j.dump(), "application/json");
-        });
+    } catch (...) {
+        res.status = 400;
+    }
+}
 
-        // POST /settings
-        server.Post("/settings", [this](const httplib::Request& req, httplib::Response& res) {
-            std::lock_guard<std::mutex> lock(mtx);
-            try {
-                auto j = json::parse(req.body);
-                if (j.contains("t_total")) settings.t_total = j["t_total"];
-                if (j.contains("dt")) settings.dt = j["dt"];
-                if (j.contains("current_time")) settings.current_time = j["current_time"];
-                if (j.contains("rewind_max_history")) settings.rewind_max_history = j["rewind_max_history"];
-                if (j.contains("history_resolution")) settings.history_resolution = j["history_resolution"];
-                bool update_bornes = false;
-                if (j.contains("MAX_Y")) { settings.MAX_Y = j["MAX_Y"]; update_bornes = true; }
-                if (j.contains("MAX_X")) { settings.MAX_X = j["MAX_X"]; update_bornes = true; }
-                if (j.contains("MAX_Z")) { settings.MAX_Z = j["MAX_Z"]; update_bornes = true; }
-                if (j.contains("MIN_Y")) { settings.MIN_Y = j["MIN_Y"]; update_bornes = true; }
-                if (j.contains("MIN_X")) { settings.MIN_X = j["MIN_X"]; update_bornes = true; }
-                if (j.contains("MIN_Z")) { settings.MIN_Z = j["MIN_Z"]; update_bornes = true; }
-                
-                if (update_bornes) {
-                    MyRNG::updateMaxMin(
-                        settings.MIN_X, settings.MAX_X, settings.MIN_Y, 
-                        settings.MAX_Y, settings.MIN_Z, settings.MAX_Z
-                    );
+// Paramètres publiés (l'état de pause, tenu par le contrôleur, est ajouté par l'appelant)
+static json settingsJson(const SimulationSettings& published) {
+    return {
+        {"t_total", published.t_total},
+        {"dt", published.dt},
+        {"nb_particles", published.nb_particles},
+        {"current_time", published.current_time},
+        {"rewind_max_history", published.rewind_max_history},
+        {"closed", published.closed},
+        {"MAX_Y", published.MAX_Y},
+        {"MAX_X", published.MAX_X},
+        {"MAX_Z", published.MAX_Z},
+        {"MIN_Y", published.MIN_Y},
+        {"MIN_X", published.MIN_X},
+        {"MIN_Z", published.MIN_Z},
+        {"history_resolution", published.history_resolution},
+        {"fmm_order", published.fmm_order},
+        {"load_imbalance", published.load_imbalance},
+        {"threads", published.threads},
+        {"affinity", published.affinity}
+    };
+}
+
+// GET /settings
+void APIRest::getSettings(SimulationContext& sim, const httplib::Request&, httplib::Response& res) {
+    // Paramètres de l'instantané publié (sans verrou), l'état du contrôleur est lu directement
+    SnapshotPublisher::Reader snapshot(sim.snapshots);
+    json j = settingsJson(snapshot->settings);
+    j["paused"] = sim.controller.isPaused();
+    res.set_content(j.dump(), "application/json");
+}
+
+// Message SSE d'un instantané : "frame" (paramètres et colonnes de l'état, indicées comme GET /particles)
+// ou "settings" (paramètres seuls) ; base_version change après un chargement, un rembobinage ou un reset
+static std::string streamEvent(const Snapshot& snapshot, bool frame) {
+    json j = {
+        {"version", snapshot.version},
+        {"state_version", snapshot.stateVersion},
+        {"base_version", snapshot.baseVersion},
+        {"settings", settingsJson(snapshot.settings)}
+    };
+    if (frame) {
+        const HistoryFrame& state = *snapshot.state;
+        std::size_t n = std::min(snapshot.info->size(), state.size());
+        const char* names[6] = {"x", "y", "z", "vx", "vy", "vz"};
+        const ArenaVector<float>* columns[6] = {&state.x, &state.y, &state.z, &state.vx, &state.vy, &state.vz};
+        for (int c = 0; c < 6; c++)
+            j[names[c]] = std::vector<float>(columns[c]->begin(), columns[c]->begin() + n);
+    }
+    return "id: " + std::to_string(snapshot.version) + "\nevent: " + (frame ? "frame" : "settings") + "\ndata: " + j.dump() + "\n\n";
+}
+
+// GET /stream[?every=k]
+// Flux SSE des publications (au plus une toutes les k versions). Chaque message est encodé une fois par
+// instantané et partagé par les abonnés. Un abonné lent reçoit le dernier instantané à son envoi suivant :
+// les trames intermédiaires sont abandonnées, la simulation n'attend jamais les abonnés.
+void APIRest::stream(const httplib::Request& req, httplib::Response& res, Resolver resolve) {
+    int every = 1;
+    if (req.has_param("every")) {
+        try {
+            every = std::max(1, std::stoi(req.get_param_value("every")));
+        } catch (...) {
+            res.status = 400;
+            return;
+        }
+    }
+    // Chaque abonné occupe un thread du serveur
+    if (++streams > MAX_STREAMS) {
+        streams--;
+        res.status = 503;
+        return;
+    }
+    std::shared_ptr<uint64_t> sent = std::make_shared<uint64_t>(0);      // Version du dernier message envoyé
+    std::shared_ptr<uint64_t> sentState = std::make_shared<uint64_t>(0); // stateVersion du dernier message envoyé
+    res.set_header("Cache-Control", "no-cache");
+    res.set_chunked_content_provider("text/event-stream",
+        [this, resolve, every, sent, sentState](std::size_t, httplib::DataSink& sink) {
+            std::shared_ptr<Session> hold;
+            SimulationContext* sim = resolve(hold);
+            if (sim == nullptr || !running) {
+                sink.done();
+                return true;
+            }
+            // Premier message immédiat, puis une publication sur every
+            uint64_t after = *sent == 0 ? 0 : *sent + every - 1;
+            if (sim->snapshots.waitForUpdate(after, std::chrono::seconds(1)) <= after) {
+                // Commentaire SSE : maintient la connexion et détecte un client parti
+                return sink.write(":\n\n", 2);
+            }
+            std::shared_ptr<const std::string> message;
+            {
+                SnapshotPublisher::Reader snapshot(sim->snapshots);
+                bool frame = *sent == 0 || snapshot->stateVersion != *sentState;
+                const Snapshot& published = *snapshot;
+                message = snapshot->cache->get(frame ? "sse.frame" : "sse.settings",
+                                               [&published, frame]() { return streamEvent(published, frame); });
+                *sent = snapshot->version;
+                *sentState = snapshot->stateVersion;
+            }
+            return sink.write(message->data(), message->size());
+        },
+        [this](bool) { streams--; });
+}
+
+// POST /settings
+// Transactionnel : les champs sont appliqués sur une copie, validée d'un bloc entre deux pas
+void APIRest::postSettings(SimulationContext& sim, const httplib::Request& req, httplib::Response& res) {
+    try {
+        auto j = json::parse(req.body);
+        // Le pool est partagé : seule la simulation principale le redimensionne
+        if (!sim.primary && (j.contains("threads") || j.contains("affinity"))) {
+            res.status = 400;
+            return;
+        }
+        if (sim.maxParticles > 0 && j.contains("nb_particles") && j["nb_particles"].get<int>() > sim.maxParticles) {
+            res.status = 413;
+            return;
+        }
+        sim.controller.submit([&]() {
+            SimulationSettings& settings = sim.settings;
+            SimulationSettings next = settings;
+            if (j.contains("t_total")) next.t_total = j["t_total"];
+            if (j.contains("dt")) next.dt = j["dt"];
+            if (j.contains("current_time")) next.current_time = j["current_time"];
+            if (j.contains("rewind_max_history")) next.rewind_max_history = j["rewind_max_history"];
+            if (sim.maxHistory > 0.f) next.rewind_max_history = std::min(next.rewind_max_history, sim.maxHistory);
+            if (j.contains("history_resolution")) next.history_resolution = j["history_resolution"];
+            if (j.contains("fmm_order")) next.fmm_order = std::max<int>(FMMSolver::MIN_ORDER, std::min<int>(FMMSolver::MAX_ORDER, j["fmm_order"]));
+            bool update_bornes = false;
+            if (j.contains("MAX_Y")) { next.MAX_Y = j["MAX_Y"]; update_bornes = true; }
+            if (j.contains("MAX_X")) { next.MAX_X = j["MAX_X"]; update_bornes = true; }
+            if (j.contains("MAX_Z")) { next.MAX_Z = j["MAX_Z"]; update_bornes = true; }
+            if (j.contains("MIN_Y")) { next.MIN_Y = j["MIN_Y"]; update_bornes = true; }
+            if (j.contains("MIN_X")) { next.MIN_X = j["MIN_X"]; update_bornes = true; }
+            if (j.contains("MIN_Z")) { next.MIN_Z = j["MIN_Z"]; update_bornes = true; }
+            if (j.contains("nb_particles")) next.nb_particles = j["nb_particles"];
+            ThreadTopology placement = topology;
+            if (j.contains("threads")) next.threads = std::max(1, j["threads"].get<int>());
+            if (j.contains("affinity")) {
+                next.affinity = j["affinity"].get<std::string>();
+                placement.setAffinity(next.affinity);
+            }
+            // Tous les champs sont valides : validation
+            settings = next;
+
+            if (j.contains("threads") || j.contains("affinity")) {
+                // Entre deux pas : aucune tâche en cours dans le pool, ni pour une session
+                std::unique_lock<std::mutex> hold;
+                if (sessions != nullptr)
+                    hold = sessions->quiesce();
+                topology = placement;
+                topology.apply(settings.threads);
+            }
+
+            if (update_bornes && sim.primary) {
+                MyRNG::updateMaxMin(
+                    settings.MIN_X, settings.MAX_X, settings.MIN_Y, 
+                    settings.MAX_Y, settings.MIN_Z, settings.MAX_Z
+                );
+            }
+            if (j.contains("nb_particles")) {
+                sim.particles.reserve(settings.nb_particles);
+                sim.particles.clear();
+                sim.history.clear();
+                for (int i = 0; i < settings.nb_particles; i++) {
+                    sim.particles.push_back(sim.randomParticle());
                 }
-                if (j.contains("nb_particles")) {
-                    settings.nb_particles = j["nb_particles"];
-                    particles.reserve(settings.nb_particles);
-                    particles.clear();
-                    for (int i = 0; i < settings.nb_particles; i++) {
-                        particles.push_back(Particle());
-                    }
-                    // Optionnel : ajouter une particule massive au centre pour influencer les autres
-                    float center_x = (settings.MIN_X + settings.MAX_X) / 2.0f;
-                    float center_y = (settings.MIN_Y + settings.MAX_Y) / 2.0f;
-                    float center_z = (settings.MIN_Z + settings.MAX_Z) / 2.0f;
-                    particles.emplace_back(center_x, center_y, center_z, 0.0f, 0.0f, 0.0f, 1e13);
+                // Optionnel : ajouter une particule massive au centre pour influencer les autres
+                float center_x = (settings.MIN_X + settings.MAX_X) / 2.0f;
+                float center_y = (settings.MIN_Y + settings.MAX_Y) / 2.0f;
+                float center_z = (settings.MIN_Z + settings.MAX_Z) / 2.0f;
+                sim.particles.emplace_back(center_x, center_y, center_z, 0.0f, 0.0f, 0.0f, 1e13);
+                if (!sim.primary) {
+                    for (std::size_t i = 0; i < sim.particles.size(); i++)
+                        sim.particles[i].setId(static_cast<int>(i));
                 }
-                tree.clear(); // Clear the octree to reset it
-                // Mettre à jour les bornes de l'octree
-                tree.updateAttributes(
-                    settings.MIN_X, settings.MIN_Y, settings.MIN_Z,
-                    std::abs(settings.MAX_X - settings.MIN_X), 
-                    std::abs(settings.MAX_Y - settings.MIN_Y), 
-                    std::abs(settings.MAX_Z - settings.MIN_Z),
-                    1 // Capacity of the octree
-                );
-                res.status = 200;
-            } catch (...) {
-                res.status = 400;
             }
+            sim.tree.clear(); // Clear the octree to reset it
+            // Mettre à jour les bornes de l'octree
+            sim.tree.updateAttributes(
+                settings.MIN_X, settings.MIN_Y, settings.MIN_Z,
+                std::abs(settings.MAX_X - settings.MIN_X), 
+                std::abs(settings.MAX_Y - settings.MIN_Y), 
+                std::abs(settings.MAX_Z - settings.MIN_Z),
+                1 // Capacity of the octree
+            );
+            if (j.contains("nb_particles"))
+                sim.snapshots.publishParticles(sim.particles, settings, sim.history);
+            else
+                sim.snapshots.publishSettings(settings);
         });
+        res.status = 200;
+    } catch (...) {
+        res.status = 400;
+    }
+}
 
-        // POST /stop
-        server.Post("/stop", [this](const httplib::Request&, httplib::Response& res) {
-            settings.closed = true;
-            res.status = 200;
-        });
+// POST /pause
+void APIRest::postPause(SimulationContext& sim, const httplib::Request&, httplib::Response& res) {
+    sim.controller.pause();
+    res.status = 200;
+}
 
-        // POST /pause
-        server.Post("/pause", [this](const httplib::Request&, httplib::Response& res) {
-            paused = true;
-            res.status = 200;
-        });
+// POST /resume
+void APIRest::postResume(SimulationContext& sim, const httplib::Request&, httplib::Response& res) {
+    sim.controller.resume();
+    res.status = 200;
+}
 
-        // POST /resume
-        server.Post("/resume", [this](const httplib::Request&, httplib::Response& res) {
-            paused = false;
-            res.status = 200;
+static json sessionJson(const SessionInfo& info) {
+    return {
+        {"id", info.id},
+        {"state", info.state},
+        {"nb_particles", info.particles},
+        {"current_time", info.currentTime},
+        {"steps", info.steps},
+        {"cpu_seconds", info.cpuSeconds},
+        {"idle_seconds", info.idleSeconds}
+    };
+}
+
+// Création, liste et suppression des sessions
+void APIRest::routeSessions() {
+    // GET /sessions
+    server.Get("/sessions", [this](const httplib::Request&, httplib::Response& res) {
+        json j = json::array();
+        for (const SessionInfo& info : sessions->list())
+            j.push_back(sessionJson(info));
+        res.set_content(j.dump(), "application/json");
+    });
+
+    // POST /sessions
+    // {"id", "particles", "seed", "paused", "dt", "t_total", "rewind_max_history"} (tous optionnels)
+    server.Post("/sessions", [this](const httplib::Request& req, httplib::Response& res) {
+        try {
+            auto j = json::parse(req.body.empty() ? "{}" : req.body);
+            std::string id = j.value("id", sessions->nextId());
+            bool valid = !id.empty() && id.size() <= 64;
+            for (char c : id)
+                valid = valid && (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-');
+            int nbParticles = j.value("particles", 1000);
+            if (!valid || nbParticles < 0) {
+                res.status = 400;
+                return;
+            }
+            if (nbParticles > sessions->limits().maxParticles) {
+                res.status = 413;
+                return;
+            }
+            SimulationSettings settings = sessions->defaultSettings();
+            settings.dt = j.value("dt", settings.dt);
+            settings.t_total = j.value("t_total", settings.t_total);
+            settings.rewind_max_history = j.value("rewind_max_history", settings.rewind_max_history);
+            sessions->create(id, settings, nbParticles, j.value("seed", 1u), j.value("paused", false));
+            SessionInfo info;
+            sessions->info(id, info);
+            res.status = 201;
+            res.set_content(sessionJson(info).dump(), "application/json");
+        } catch (const std::invalid_argument&) {
+            res.status = 409;
+        } catch (const std::length_error&) {
+            res.status = 503;
+        } catch (...) {
+            res.status = 400;
+        }
+    });
+
+    // GET /sessions/{id}
+    server.Get("/sessions/:id", [this](const httplib::Request& req, httplib::Response& res) {
+        SessionInfo info;
+        if (!sessions->acquire(req.path_params.at("id")) || !sessions->info(req.path_params.at("id"), info)) {
+            res.status = 404;
+            return;
+        }
+        res.set_content(sessionJson(info).dump(), "application/json");
+    });
+
+    // GET /sessions/{id}/stream (la session reste active tant qu'un abonné la suit)
+    server.Get("/sessions/:id/stream", [this](const httplib::Request& req, httplib::Response& res) {
+        std::string id = req.path_params.at("id");
+        if (!sessions->acquire(id)) {
+            res.status = 404;
+            return;
+        }
+        stream(req, res, [this, id](std::shared_ptr<Session>& hold) {
+            hold = sessions->acquire(id);
+            return hold ? &hold->context() : nullptr;
         });
+    });
 
-        server.listen("0.0.0.0", port);
+    // DELETE /sessions/{id}
+    server.Delete("/sessions/:id", [this](const httplib::Request& req, httplib::Response& res) {
+        res.status = sessions->remove(req.path_params.at("id")) ? 200 : 404;
     });
 }
 
@@ -2,41 +2,64 @@
 #define APIREST_HPP
 
 #include <vector>
-#include <mutex>
 #include <thread>
 #include <atomic>
 #include "Particle.hpp"
 #include "Octree.hpp"
+#include "HistoryBuffer.hpp"
+#include "Snapshot.hpp"
+#include "SimulationSettings.hpp"
+#include "SimulationController.hpp"
+#include "ThreadTopology.hpp"
+#include "Session.hpp"
 
 #include "httplib.h"
 
-struct SimulationSettings {
-    float t_total;
-    float dt;
-    int nb_particles;
-    float current_time;
-    float rewind_max_history; // Durée maximale de l'historique de position des particules
-    bool closed;
-    float MAX_Y, MAX_X, MAX_Z;
-    float MIN_Y, MIN_X, MIN_Z;
-    float history_resolution;
-};
 
 class APIRest {
 public:
-    APIRest(Octree& tree, std::vector<Particle>& particles, SimulationSettings& settings, std::atomic<bool>& paused, std::mutex& mtx);
+    // sessions : sessions servies sous /sessions/{id}/... (nullptr : simulation principale seule)
+    APIRest(Octree& tree, std::vector<Particle>& particles, HistoryBuffer& history, SnapshotPublisher& snapshots, SimulationSettings& settings, SimulationController& controller, ThreadTopology& topology, SessionManager* sessions = nullptr);
     void start(int port = 8080);
     void stop();
 
 private:
+    // Route commune à la simulation principale et aux sessions
+    typedef void (APIRest::*Handler)(SimulationContext&, const httplib::Request&, httplib::Response&);
+    // Simulation suivie par un flux, résolue à chaque message (hold garde la session en vie ; nullptr : terminée)
+    typedef std::function<SimulationContext*(std::shared_ptr<Session>& hold)> Resolver;
+
+    // Abonnés simultanés à GET /stream (chacun occupe un thread du serveur)
+    static const int MAX_STREAMS = 4;
+
     std::thread server_thread;
     std::atomic<bool> running;
+    std::atomic<int> streams;
     httplib::Server server;
-    std::vector<Particle>& particles;
-    SimulationSettings& settings;
-    std::atomic<bool>& paused;
-    std::mutex& mtx;
-    Octree& tree;
+    SimulationContext simulation; // Simulation principale (état modifié uniquement par les commandes, dans le thread de simulation)
+    ThreadTopology& topology; // Placement des threads de simulation, réservé sur les cœurs de l'API
+    SessionManager* sessions;
+
+    // Enregistre path pour la simulation principale et /sessions/{id}path pour chaque session
+    void route(const char *method, const std::string& path, Handler handler);
+
+    void getParticles(SimulationContext& sim, const httplib::Request& req, httplib::Response& res);
+    void getParticlesBinary(SimulationContext& sim, const httplib::Request& req, httplib::Response& res);
+    void postParticles(SimulationContext& sim, const httplib::Request& req, httplib::Response& res);
+    void postRewind(SimulationContext& sim, const httplib::Request& req, httplib::Response& res);
+    void postReset(SimulationContext& sim, const httplib::Request& req, httplib::Response& res);
+    void getSettings(SimulationContext& sim, const httplib::Request& req, httplib::Response& res);
+    void postSettings(SimulationContext& sim, const httplib::Request& req, httplib::Response& res);
+    void postPause(SimulationContext& sim, const httplib::Request& req, httplib::Response& res);
+    void postResume(SimulationContext& sim, const httplib::Request& req, httplib::Response& res);
+    void queryBox(SimulationContext& sim, const httplib::Request& req, httplib::Response& res);
+    void queryRadius(SimulationContext& sim, const httplib::Request& req, httplib::Response& res);
+    void queryNearest(SimulationContext& sim, const httplib::Request& req, httplib::Response& res);
+    void getLevelOfDetail(SimulationContext& sim, const httplib::Request& req, httplib::Response& res);
+    void stream(const httplib::Request& req, httplib::Response& res, Resolver resolve);
+
+    // Création, liste et suppression des sessions
+    void routeSessions();
 };
 
-#endif // APIREST_HPP
\ No newline at end of file
+#endif // APIREST_HPP
@@ -0,0 +1,173 @@
+#include "Arena.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Taille projetée d'un grand bloc, arrondie à la page large
+static std::size_t mappedBytes(std::size_t bytes) {
+    return (bytes + Arena::HUGE_PAGE - 1) / Arena::HUGE_PAGE * Arena::HUGE_PAGE;
+}
+
+#ifdef __linux__
+// Nœuds NUMA en ligne (liste "0-1" de /sys), {0} sans NUMA
+static std::vector<int> onlineNodes() {
+    std::vector<int> nodes;
+    std::ifstream in("/sys/devices/system/node/online");
+    std::string list, item;
+    if (in >> list) {
+        std::stringstream items(list);
+        while (std::getline(items, item, ',')) {
+            std::size_t dash = item.find('-');
+            int first = std::atoi(item.substr(0, dash).c_str());
+            int last = dash == std::string::npos ? first : std::atoi(item.substr(dash + 1).c_str());
+            for (int node = first; node <= last; node++)
+                nodes.push_back(node);
+        }
+    }
+    if (nodes.empty())
+        nodes.push_back(0);
+    return nodes;
+}
+
+// Répartition en alternance des pages du bloc sur les nœuds (mbind, MPOL_INTERLEAVE)
+static void interleave(void *data, std::size_t bytes) {
+    std::vector<int> nodes = onlineNodes();
+    if (nodes.size() < 2)
+        return;
+    const int MPOL_INTERLEAVE_MODE = 3;
+    unsigned long mask[16] = {0};
+    int maxNode = 0;
+    for (int node : nodes) {
+        if (node >= 16 * 64)
+            continue;
+        mask[node / 64] |= 1UL << (node % 64);
+        maxNode = std::max(maxNode, node);
+    }
+    syscall(SYS_mbind, data, bytes, MPOL_INTERLEAVE_MODE, mask, maxNode + 2, 0);
+}
+#endif
+
+void* Arena::allocate(std::size_t bytes, Policy policy) {
+    if (bytes == 0)
+        bytes = 1;
+#ifdef __linux__
+    if (bytes >= LARGE_BLOCK) {
+        // Projection d'une page large de plus, puis rendu des marges pour garder un bloc aligné
+        std::size_t mapped = mappedBytes(bytes);
+        void *raw = mmap(nullptr, mapped + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+            throw std::bad_alloc();
+        std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw);
+        std::uintptr_t aligned = (start + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+        if (aligned > start)
+            munmap(raw, aligned - start);
+        munmap(reinterpret_cast<void*>(aligned + mapped), start + HUGE_PAGE - aligned);
+        void *data = reinterpret_cast<void*>(aligned);
+        madvise(data, mapped, MADV_HUGEPAGE);
+        if (policy == INTERLEAVE)
+            interleave(data, mapped);
+        return data;
+    }
+#endif
+    (void)policy;
+    void *data = nullptr;
+    if (posix_memalign(&data, 64, bytes) != 0)
+        throw std::bad_alloc();
+    return data;
+}
+
+void Arena::release(void *data, std::size_t bytes) {
+    if (data == nullptr)
+        return;
+    if (bytes == 0)
+        bytes = 1;
+#ifdef __linux__
+    if (bytes >= LARGE_BLOCK) {
+        munmap(data, mappedBytes(bytes));
+        return;
+    }
+#endif
+    free(data);
+}
+
+// Pages larges de la projection contenant data (AnonHugePages de /proc/self/smaps)
+static std::size_t hugeBytesAt(const void *data) {
+    std::size_t result = 0;
+#ifdef __linux__
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(data);
+    bool inside = false;
+    while (std::getline(smaps, line)) {
+        unsigned long lo, hi;
+        if (std::sscanf(line.c_str(), "%lx-%lx ", &lo, &hi) == 2 && line.find(':') > line.find(' ')) {
+            inside = address >= lo && address < hi;
+            continue;
+        }
+        unsigned long kb;
+        if (inside && std::sscanf(line.c_str(), "AnonHugePages: %lu kB", &kb) == 1) {
+            result = kb * 1024;
+            break;
+        }
+    }
+#else
+    (void)data;
+#endif
+    return result;
+}
+
+// Placement d'un tableau : pages par nœud NUMA et part en pages larges
+Arena::Placement Arena::placement(const void *data, std::size_t bytes) {
+    Placement result;
+    result.bytes = bytes;
+    result.untouchedPages = 0;
+    result.hugeBytes = 0;
+    if (data == nullptr || bytes == 0)
+        return result;
+#ifdef __linux__
+    std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::uintptr_t first = reinterpret_cast<std::uintptr_t>(data) / pageSize * pageSize;
+    std::uintptr_t last = reinterpret_cast<std::uintptr_t>(data) + bytes;
+    std::vector<void*> pages;
+    for (std::uintptr_t page = first; page < last; page += pageSize)
+        pages.push_back(reinterpret_cast<void*>(page));
+    std::vector<int> status(pages.size(), -1);
+    // move_pages sans nœuds cibles : renvoie seulement le nœud de chaque page
+    if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0) == 0) {
+        for (int node : status) {
+            if (node < 0) {
+                result.untouchedPages++;
+                continue;
+            }
+            if (static_cast<std::size_t>(node) >= result.pagesPerNode.size())
+                result.pagesPerNode.resize(node + 1, 0);
+            result.pagesPerNode[node]++;
+        }
+    }
+    result.hugeBytes = hugeBytesAt(data);
+#endif
+    return result;
+}
+
+void Arena::printReport(const std::vector<Region> &regions) {
+    printf("Placement mémoire :\n");
+    for (const Region &region : regions) {
+        Placement p = placement(region.data, region.bytes);
+        printf("  %-16s %8.2f Mo", region.name.c_str(), region.bytes / (1024. * 1024.));
+        for (std::size_t node = 0; node < p.pagesPerNode.size(); node++)
+            printf("  nœud %zu : %zu pages", node, p.pagesPerNode[node]);
+        if (p.untouchedPages > 0)
+            printf("  non touchées : %zu", p.untouchedPages);
+        printf("  pages larges : %.1f Mo\n", p.hugeBytes / (1024. * 1024.));
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// Mémoire des grands tableaux de calcul (colonnes de l'arbre, trames d'historique)
+//
+// Les blocs d'au moins Arena::LARGE_BLOCK octets sont pris directement au système (mmap), alignés sur
+// 2 Mo et marqués pour les pages larges transparentes (MADV_HUGEPAGE). Aucune page n'est écrite à
+// l'allocation : avec FIRST_TOUCH, chaque page est placée sur le nœud NUMA du thread qui l'écrit le
+// premier (remplissage parallèle par le pool, découpé comme la boucle des forces) ; avec INTERLEAVE,
+// les pages sont réparties en alternance sur les nœuds (données lues par tous les threads).
+namespace Arena {
+    enum Policy { FIRST_TOUCH, INTERLEAVE };
+
+    const std::size_t LARGE_BLOCK = 1 << 20;
+    const std::size_t HUGE_PAGE = 2 << 20;
+
+    void* allocate(std::size_t bytes, Policy policy);
+    void release(void *data, std::size_t bytes);
+
+    // Placement d'un tableau : pages par nœud NUMA et part en pages larges
+    struct Placement {
+        std::size_t bytes;
+        std::vector<std::size_t> pagesPerNode; // Indice = nœud ; pages non encore touchées exclues
+        std::size_t untouchedPages;
+        std::size_t hugeBytes;                 // Octets de la projection en pages larges (AnonHugePages)
+    };
+    Placement placement(const void *data, std::size_t bytes);
+
+    // Tableau nommé pour le rapport de placement
+    struct Region {
+        std::string name;
+        const void *data;
+        std::size_t bytes;
+    };
+    void printReport(const std::vector<Region> &regions);
+}
+
+// Allocateur des tableaux d'arène ; construct() sans argument n'initialise pas (resize() n'écrit aucune page,
+// le premier remplissage fait le placement)
+template <typename T, Arena::Policy P = Arena::FIRST_TOUCH>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    template <typename U> struct rebind { typedef ArenaAllocator<U, P> other; };
+
+    ArenaAllocator() {}
+    template <typename U> ArenaAllocator(const ArenaAllocator<U, P> &) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(Arena::allocate(n * sizeof(T), P));
+    }
+    void deallocate(T *data, std::size_t n) {
+        Arena::release(data, n * sizeof(T));
+    }
+
+    template <typename U> void construct(U *data) { ::new (static_cast<void*>(data)) U; }
+    template <typename U, typename... Args> void construct(U *data, Args&&... args) {
+        ::new (static_cast<void*>(data)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U> bool operator==(const ArenaAllocator<U, P> &) const { return true; }
+    template <typename U> bool operator!=(const ArenaAllocator<U, P> &) const { return false; }
+};
+
+template <typename T> using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+template <typename T> using InterleavedVector = std::vector<T, ArenaAllocator<T, Arena::INTERLEAVE> >;
+
+// Redimensionne un tableau dont tout le contenu va être réécrit : en cas d'agrandissement, l'ancien bloc est
+// libéré au lieu d'être recopié (la recopie ferait toucher toutes les pages par le thread appelant)
+template <typename V>
+void arenaResize(V &v, std::size_t n) {
+    if (v.capacity() < n) {
+        V().swap(v);
+        v.reserve(n);
+    }
+    v.resize(n);
+}
+
+#endif // ARENA_HPP
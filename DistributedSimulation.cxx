@@ -0,0 +1,357 @@
+#include "DistributedSimulation.hpp"
+#include "Gravity.hpp"
+#include "TaskPool.hpp"
+#include "MyRNG.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+
+MpiEnvironment::MpiEnvironment(int &argc, char **&argv) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+}
+
+MpiEnvironment::~MpiEnvironment() {
+    MPI_Finalize();
+}
+
+// Nombre d'échantillons de clés par rang pour le calcul des intervalles de la courbe
+static const int KEY_SAMPLES = 64;
+static const std::size_t PARTICLE_GRAIN = 1024;
+
+DistributedSimulation::DistributedSimulation(MPI_Comm comm)
+    : comm(comm), tree(X_MIN, Y_MIN, Z_MIN, X_MAX - X_MIN, Y_MAX - Y_MIN, Z_MAX - Z_MIN, 1),
+      migratedCount(0), sourceCount(0) {
+    MPI_Comm_rank(comm, &rankId);
+    MPI_Comm_size(comm, &nbRanks);
+}
+
+int DistributedSimulation::rank() const { return rankId; }
+int DistributedSimulation::size() const { return nbRanks; }
+
+// Diffusion de l'ordre du rang 0 ; en attente, les autres rangs dorment par tranches de 1 ms
+// (un MPI_Bcast bloquant scruterait le réseau à 100 % pendant les pauses)
+void DistributedSimulation::broadcast(Control &control) {
+    MPI_Request request;
+    MPI_Ibcast(&control, sizeof(Control), MPI_BYTE, 0, comm, &request);
+    int done = 0;
+    while (true) {
+        MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+        if (done)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// Rang 0 : un pas collectif sur l'état global
+void DistributedSimulation::step(std::vector<Particle> &global, float dt, bool reload) {
+    Control control;
+    control.op = reload ? RELOAD_STEP : STEP;
+    control.dt = dt;
+    float bounds[6] = {X_MIN, X_MAX, Y_MIN, Y_MAX, Z_MIN, Z_MAX};
+    std::copy(bounds, bounds + 6, control.bounds);
+    broadcast(control);
+    execute(control, &global);
+}
+
+// Rang 0 : termine la boucle des autres rangs
+void DistributedSimulation::stop() {
+    Control control;
+    control.op = STOP;
+    control.dt = 0.f;
+    std::fill(control.bounds, control.bounds + 6, 0.f);
+    broadcast(control);
+}
+
+// Autres rangs : exécute les pas ordonnés par le rang 0 jusqu'à stop()
+void DistributedSimulation::serve() {
+    while (true) {
+        Control control;
+        broadcast(control);
+        if (control.op == STOP)
+            return;
+        execute(control, nullptr);
+    }
+}
+
+void DistributedSimulation::execute(const Control &control, std::vector<Particle> *global) {
+    const float *b = control.bounds;
+    if (b[0] != X_MIN || b[1] != X_MAX || b[2] != Y_MIN || b[3] != Y_MAX || b[4] != Z_MIN || b[5] != Z_MAX)
+        MyRNG::updateMaxMin(b[0], b[1], b[2], b[3], b[4], b[5]);
+    if (control.op == RELOAD_STEP) {
+        // L'état global du rang 0 repart de ce rang ; la migration le répartit
+        local.clear();
+        if (global != nullptr) {
+            local = *global;
+            globalIndex.clear();
+            for (std::size_t i = 0; i < global->size(); i++)
+                globalIndex[(*global)[i].getId()] = i;
+        }
+    }
+    migrate();
+    std::vector<Source> sources;
+    exchangeEssentialTree(sources);
+    computeForces(sources, control.dt);
+    gather(global);
+}
+
+// Clé de Morton (21 bits par axe) de la position dans la boîte de simulation
+uint64_t DistributedSimulation::mortonKey(const Particle &p) const {
+    const uint32_t cells = 1u << 21;
+    float coords[3] = {(p.x() - X_MIN) / (X_MAX - X_MIN), (p.y() - Y_MIN) / (Y_MAX - Y_MIN), (p.z() - Z_MIN) / (Z_MAX - Z_MIN)};
+    uint64_t key = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        float c = std::min(std::max(coords[axis], 0.f), 1.f);
+        uint64_t cell = std::min<uint64_t>(static_cast<uint64_t>(c * cells), cells - 1);
+        // Étalement des bits : un bit de l'axe tous les 3 bits
+        cell = (cell | (cell << 32)) & 0x1f00000000ffffULL;
+        cell = (cell | (cell << 16)) & 0x1f0000ff0000ffULL;
+        cell = (cell | (cell << 8)) & 0x100f00f00f00f00fULL;
+        cell = (cell | (cell << 4)) & 0x10c30c30c30c30c3ULL;
+        cell = (cell | (cell << 2)) & 0x1249249249249249ULL;
+        key |= cell << axis;
+    }
+    return key;
+}
+
+// Migration des particules vers le rang propriétaire de leur intervalle de la courbe de Morton
+void DistributedSimulation::migrate() {
+    std::size_t n = local.size();
+    std::vector<uint64_t> keys(n);
+    for (std::size_t i = 0; i < n; i++)
+        keys[i] = mortonKey(local[i]);
+
+    // Échantillons réguliers des clés triées de chaque rang, chacun pesant (particules du rang / échantillons)
+    std::vector<uint64_t> sorted = keys;
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<uint64_t> samples;
+    int nbSamples = static_cast<int>(std::min<std::size_t>(n, KEY_SAMPLES));
+    for (int s = 0; s < nbSamples; s++)
+        samples.push_back(sorted[s * n / nbSamples]);
+    double weight = nbSamples > 0 ? static_cast<double>(n) / nbSamples : 0.;
+
+    std::vector<int> sampleCounts(nbRanks), sampleDispls(nbRanks);
+    std::vector<double> weights(nbRanks);
+    MPI_Allgather(&nbSamples, 1, MPI_INT, sampleCounts.data(), 1, MPI_INT, comm);
+    MPI_Allgather(&weight, 1, MPI_DOUBLE, weights.data(), 1, MPI_DOUBLE, comm);
+    int totalSamples = 0;
+    for (int r = 0; r < nbRanks; r++) {
+        sampleDispls[r] = totalSamples;
+        totalSamples += sampleCounts[r];
+    }
+    std::vector<uint64_t> allSamples(totalSamples);
+    MPI_Allgatherv(samples.data(), nbSamples, MPI_UINT64_T, allSamples.data(), sampleCounts.data(),
+                   sampleDispls.data(), MPI_UINT64_T, comm);
+
+    std::vector<std::pair<uint64_t, double> > weighted;
+    double total = 0.;
+    for (int r = 0; r < nbRanks; r++)
+        for (int s = 0; s < sampleCounts[r]; s++) {
+            weighted.push_back(std::make_pair(allSamples[sampleDispls[r] + s], weights[r]));
+            total += weights[r];
+        }
+    std::sort(weighted.begin(), weighted.end());
+    // Séparateurs : le rang r possède les clés de [splitters[r - 1], splitters[r])
+    std::vector<uint64_t> splitters;
+    double cumulated = 0.;
+    std::size_t w = 0;
+    for (int r = 1; r < nbRanks; r++) {
+        double target = total * r / nbRanks;
+        while (w < weighted.size() && cumulated + weighted[w].second <= target)
+            cumulated += weighted[w++].second;
+        splitters.push_back(w < weighted.size() ? weighted[w].first : std::numeric_limits<uint64_t>::max());
+    }
+
+    // Envoi des partantes (regroupées par destination), les autres restent en place
+    std::vector<int> destination(n);
+    std::vector<int> sendCounts(nbRanks, 0), recvCounts(nbRanks), sendDispls(nbRanks), recvDispls(nbRanks);
+    for (std::size_t i = 0; i < n; i++) {
+        destination[i] = static_cast<int>(std::upper_bound(splitters.begin(), splitters.end(), keys[i]) - splitters.begin());
+        if (destination[i] != rankId)
+            sendCounts[destination[i]] += sizeof(Record);
+    }
+    MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT, comm);
+    int sendTotal = 0, recvTotal = 0;
+    for (int r = 0; r < nbRanks; r++) {
+        sendDispls[r] = sendTotal;
+        recvDispls[r] = recvTotal;
+        sendTotal += sendCounts[r];
+        recvTotal += recvCounts[r];
+    }
+    std::vector<Record> outgoing(sendTotal / sizeof(Record)), incoming(recvTotal / sizeof(Record));
+    std::vector<int> fill(sendDispls);
+    std::vector<Particle> staying;
+    staying.reserve(n);
+    for (std::size_t i = 0; i < n; i++) {
+        const Particle &p = local[i];
+        if (destination[i] == rankId) {
+            staying.push_back(p);
+            continue;
+        }
+        Vector3D v = p.getVelocity();
+        Record &r = outgoing[fill[destination[i]] / sizeof(Record)];
+        fill[destination[i]] += sizeof(Record);
+        r.id = p.getId();
+        r.x = p.x(); r.y = p.y(); r.z = p.z();
+        r.vx = v.x; r.vy = v.y; r.vz = v.z;
+        r.mass = p.getMass();
+        r.masseVolumique = p.getMasseVolumique();
+    }
+    MPI_Alltoallv(outgoing.data(), sendCounts.data(), sendDispls.data(), MPI_BYTE,
+                  incoming.data(), recvCounts.data(), recvDispls.data(), MPI_BYTE, comm);
+
+    // Les particules reçues gardent leur identifiant (le compteur global n'avance pas)
+    int savedCounter = Particle::id_counter;
+    for (const Record &r : incoming) {
+        staying.push_back(Particle(r.x, r.y, r.z, r.vx, r.vy, r.vz, r.mass, r.masseVolumique));
+        staying.back().setId(r.id);
+    }
+    Particle::id_counter = savedCounter;
+    local.swap(staying);
+    migratedCount = static_cast<long long>(incoming.size());
+}
+
+// Branches essentielles : sources de l'octree local nécessaires à chaque autre rang
+void DistributedSimulation::exchangeEssentialTree(std::vector<Source> &sources) {
+    // Boîtes englobantes des particules de chaque rang (vide : min > max)
+    float box[6] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                    std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+    for (const Particle &p : local) {
+        box[0] = std::min(box[0], p.x()); box[3] = std::max(box[3], p.x());
+        box[1] = std::min(box[1], p.y()); box[4] = std::max(box[4], p.y());
+        box[2] = std::min(box[2], p.z()); box[5] = std::max(box[5], p.z());
+    }
+    std::vector<float> boxes(6 * nbRanks);
+    MPI_Allgather(box, 6, MPI_FLOAT, boxes.data(), 6, MPI_FLOAT, comm);
+
+    tree.updateAttributes(X_MIN, Y_MIN, Z_MIN, X_MAX - X_MIN, Y_MAX - Y_MIN, Z_MAX - Z_MIN, 1);
+    tree.build(local);
+    const InterleavedVector<Octree::FlatNode> &nodes = tree.flatNodes;
+
+    std::vector<std::vector<Source> > outgoing(nbRanks);
+    for (int r = 0; r < nbRanks; r++) {
+        const float *b = &boxes[6 * r];
+        if (r == rankId || b[0] > b[3] || local.empty())
+            continue;
+        std::vector<Source> &out = outgoing[r];
+        uint32_t i = 0;
+        while (i < nodes.size()) {
+            const Octree::FlatNode &node = nodes[i];
+            if (node.mass == 0.f) {
+                i = node.next;
+                continue;
+            }
+            if (node.leafCount > 0) {
+                // Feuille : ses particules, comme dans le parcours local (somme directe)
+                for (uint32_t k = node.begin; k < node.begin + node.leafCount; k++)
+                    out.push_back({tree.sortedX[k], tree.sortedY[k], tree.sortedZ[k], tree.sortedMass[k]});
+                i = node.next;
+                continue;
+            }
+            // Distance minimale du centre de masse à la boîte du rang : accepté pour chacune de ses particules
+            float dx = std::max(std::max(b[0] - node.comX, node.comX - b[3]), 0.f);
+            float dy = std::max(std::max(b[1] - node.comY, node.comY - b[4]), 0.f);
+            float dz = std::max(std::max(b[2] - node.comZ, node.comZ - b[5]), 0.f);
+            if (node.sizeSq < theta_sq * (dx * dx + dy * dy + dz * dz + epsilon_sq)) {
+                out.push_back({node.comX, node.comY, node.comZ, node.mass});
+                i = node.next;
+            } else {
+                i++;
+            }
+        }
+    }
+
+    std::vector<int> sendCounts(nbRanks), recvCounts(nbRanks), sendDispls(nbRanks), recvDispls(nbRanks);
+    for (int r = 0; r < nbRanks; r++)
+        sendCounts[r] = static_cast<int>(outgoing[r].size() * sizeof(Source));
+    MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT, comm);
+    int sendTotal = 0, recvTotal = 0;
+    for (int r = 0; r < nbRanks; r++) {
+        sendDispls[r] = sendTotal;
+        recvDispls[r] = recvTotal;
+        sendTotal += sendCounts[r];
+        recvTotal += recvCounts[r];
+    }
+    std::vector<Source> packed;
+    packed.reserve(sendTotal / sizeof(Source));
+    for (int r = 0; r < nbRanks; r++)
+        packed.insert(packed.end(), outgoing[r].begin(), outgoing[r].end());
+    sources.resize(recvTotal / sizeof(Source));
+    MPI_Alltoallv(packed.data(), sendCounts.data(), sendDispls.data(), MPI_BYTE,
+                  sources.data(), recvCounts.data(), recvDispls.data(), MPI_BYTE, comm);
+    sourceCount = static_cast<long long>(sources.size());
+}
+
+// Forces sur les particules locales (octree des locales et des sources reçues), puis intégration
+void DistributedSimulation::computeForces(const std::vector<Source> &sources, float dt) {
+    std::size_t n = local.size();
+    int savedCounter = Particle::id_counter;
+    local.reserve(n + sources.size());
+    for (const Source &s : sources)
+        local.push_back(Particle(s.x, s.y, s.z, 0.f, 0.f, 0.f, s.mass));
+    Particle::id_counter = savedCounter;
+
+    tree.updateAttributes(X_MIN, Y_MIN, Z_MIN, X_MAX - X_MIN, Y_MAX - Y_MIN, Z_MAX - Z_MIN, 1);
+    tree.build(local);
+    TaskPool &pool = TaskPool::global();
+    pool.parallelFor(0, n, PARTICLE_GRAIN, [&](std::size_t i) {
+        local[i].resetAcceleration();
+        local[i].addAcceleration(tree.computeAcceleration(local[i]));
+    });
+    local.erase(local.begin() + n, local.end());
+    pool.parallelFor(0, n, PARTICLE_GRAIN, [&](std::size_t i) {
+        local[i].updateVelocity(dt);
+        local[i].updatePosition(dt);
+        local[i].checkBoundary();
+    });
+}
+
+// Rassemble positions et vitesses sur le rang 0 (état global, rangé par identifiant)
+void DistributedSimulation::gather(std::vector<Particle> *global) {
+    std::vector<Record> outgoing(local.size());
+    for (std::size_t i = 0; i < local.size(); i++) {
+        const Particle &p = local[i];
+        Vector3D v = p.getVelocity();
+        Record &r = outgoing[i];
+        r.id = p.getId();
+        r.x = p.x(); r.y = p.y(); r.z = p.z();
+        r.vx = v.x; r.vy = v.y; r.vz = v.z;
+        r.mass = p.getMass();
+        r.masseVolumique = p.getMasseVolumique();
+    }
+    int bytes = static_cast<int>(outgoing.size() * sizeof(Record));
+    std::vector<int> counts(nbRanks), displs(nbRanks);
+    MPI_Gather(&bytes, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+    long long mine[3] = {static_cast<long long>(local.size()), migratedCount, sourceCount};
+    stats.resize(3 * nbRanks);
+    MPI_Gather(mine, 3, MPI_LONG_LONG, stats.data(), 3, MPI_LONG_LONG, 0, comm);
+
+    int total = 0;
+    if (rankId == 0)
+        for (int r = 0; r < nbRanks; r++) {
+            displs[r] = total;
+            total += counts[r];
+        }
+    std::vector<Record> incoming(total / sizeof(Record));
+    MPI_Gatherv(outgoing.data(), bytes, MPI_BYTE, incoming.data(), counts.data(), displs.data(), MPI_BYTE, 0, comm);
+    if (rankId != 0 || global == nullptr)
+        return;
+    for (const Record &r : incoming) {
+        auto found = globalIndex.find(r.id);
+        if (found == globalIndex.end())
+            continue;
+        Particle &p = (*global)[found->second];
+        p.setPosition(Vector3D(r.x, r.y, r.z));
+        p.setVelocity(Vector3D(r.vx, r.vy, r.vz));
+    }
+}
+
+// Rang 0 : particules, migrations et sources reçues par rang au dernier pas
+void DistributedSimulation::printReport() const {
+    for (int r = 0; r < nbRanks && 3 * r + 2 < static_cast<int>(stats.size()); r++)
+        printf("  rang %d : %lld particules, %lld reçues, %lld sources distantes\n",
+               r, stats[3 * r], stats[3 * r + 1], stats[3 * r + 2]);
+}
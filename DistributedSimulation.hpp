@@ -0,0 +1,83 @@
+#ifndef DISTRIBUTEDSIMULATION_HPP
+#define DISTRIBUTEDSIMULATION_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include <mpi.h>
+
+#include "Particle.hpp"
+#include "Octree.hpp"
+
+// Initialisation et fin de MPI pour la durée de main (threads de l'API et du pool sans appel MPI)
+struct MpiEnvironment {
+    MpiEnvironment(int &argc, char **&argv);
+    ~MpiEnvironment();
+};
+
+// Simulation répartie sur les processus MPI (décomposition de domaine)
+//
+// Chaque rang possède les particules d'un intervalle de la courbe de Morton sur la boîte de simulation.
+// Un pas :
+//   1. migration : les intervalles sont recalculés par échantillonnage pondéré des clés, chaque particule
+//      part vers le rang propriétaire de sa clé ;
+//   2. arbre localement essentiel (LET) : pour chaque autre rang, l'octree local envoie le monopôle des nœuds
+//      acceptés par le critère d'ouverture depuis tout point de la boîte englobante de ce rang, et les
+//      particules des feuilles atteintes sinon ;
+//   3. forces des particules locales sur l'octree des particules locales et des sources reçues, intégration.
+// Le rang 0 pilote (commandes de l'API) et rassemble l'état global à chaque pas pour l'historique et les
+// instantanés ; les autres rangs attendent ses ordres dans serve().
+class DistributedSimulation {
+public:
+    explicit DistributedSimulation(MPI_Comm comm);
+
+    int rank() const;
+    int size() const;
+
+    // Rang 0 : un pas collectif sur l'état global ; reload redistribue d'abord cet état (modifié par l'API)
+    void step(std::vector<Particle> &global, float dt, bool reload);
+    // Rang 0 : termine la boucle des autres rangs
+    void stop();
+    // Autres rangs : exécute les pas ordonnés par le rang 0 jusqu'à stop()
+    void serve();
+
+    // Rang 0 : particules, migrations et sources reçues par rang au dernier pas
+    void printReport() const;
+
+private:
+    // Particule échangée entre rangs
+    struct Record {
+        int32_t id;
+        float x, y, z, vx, vy, vz, mass, masseVolumique;
+    };
+    // Source de gravité d'une branche essentielle (monopôle ou particule d'une feuille)
+    struct Source {
+        float x, y, z, mass;
+    };
+    // Ordre diffusé par le rang 0 au début de chaque pas
+    struct Control {
+        int32_t op;
+        float dt;
+        float bounds[6]; // X_MIN, X_MAX, Y_MIN, Y_MAX, Z_MIN, Z_MAX (modifiables via l'API)
+    };
+    enum { STEP, RELOAD_STEP, STOP };
+
+    MPI_Comm comm;
+    int rankId, nbRanks;
+    std::vector<Particle> local;
+    Octree tree;
+    std::unordered_map<int, std::size_t> globalIndex; // Rang 0 : identifiant -> indice dans l'état global
+    std::vector<long long> stats;                     // Rang 0 : (locales, migrées, sources) par rang
+    long long migratedCount, sourceCount;
+
+    void broadcast(Control &control);
+    void execute(const Control &control, std::vector<Particle> *global);
+    void migrate();
+    void exchangeEssentialTree(std::vector<Source> &sources);
+    void computeForces(const std::vector<Source> &sources, float dt);
+    void gather(std::vector<Particle> *global);
+    uint64_t mortonKey(const Particle &p) const;
+};
+
+#endif // DISTRIBUTEDSIMULATION_HPP
@@ -0,0 +1,255 @@
+#include "Ensemble.hpp"
+#include "Octree.hpp"
+#include "Gravity.hpp"
+#include "MyRNG.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <chrono>
+
+#include <sys/stat.h>
+
+#include <boost/random.hpp>
+
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+static const std::size_t PARTICLE_GRAIN = 1024;
+
+EnsembleRunner::EnsembleRunner(TaskPool &pool, int directBelow, double batchCost)
+    : pool(pool), directBelow(directBelow), batchCost(batchCost) {}
+
+// Champs d'un membre lus par-dessus ceux de base
+static EnsembleMember readMember(const json &j, EnsembleMember base) {
+    base.name = j.value("name", base.name);
+    base.scenario = j.value("scenario", base.scenario);
+    base.particles = j.value("particles", base.particles);
+    base.seed = j.value("seed", base.seed);
+    base.centralMass = j.value("central_mass", base.centralMass);
+    base.dt = j.value("dt", base.dt);
+    base.t_total = j.value("t_total", base.t_total);
+    base.theta = j.value("theta", base.theta);
+    // theta = 0 n'accepterait aucun nœud interne : somme directe déguisée, refusée
+    if (!(base.theta > 0.f))
+        throw std::runtime_error("theta doit être strictement positif : " + std::to_string(base.theta));
+    return base;
+}
+
+// Membres d'un fichier JSON : "defaults", liste "members" et/ou "sweep" (produit cartésien des valeurs)
+std::vector<EnsembleMember> EnsembleRunner::load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("fichier de scénarios introuvable : " + path);
+    json j = json::parse(in);
+
+    EnsembleMember defaults{"membre", "", 1000, 1, true, 0.5f, 50.f, theta};
+    if (j.contains("defaults"))
+        defaults = readMember(j["defaults"], defaults);
+
+    std::vector<EnsembleMember> members;
+    if (j.contains("members"))
+        for (const auto &jm : j["members"])
+            members.push_back(readMember(jm, defaults));
+    if (j.contains("sweep")) {
+        // Produit cartésien : chaque clé multiplie les variantes déjà construites
+        std::vector<json> variants(1, json::object());
+        for (const auto &axis : j["sweep"].items()) {
+            std::vector<json> next;
+            for (const auto &variant : variants)
+                for (const auto &value : axis.value()) {
+                    json v = variant;
+                    v[axis.key()] = value;
+                    next.push_back(v);
+                }
+            variants.swap(next);
+        }
+        for (const auto &variant : variants) {
+            EnsembleMember m = readMember(variant, defaults);
+            if (!variant.contains("name")) {
+                m.name = defaults.name;
+                for (const auto &field : variant.items())
+                    m.name += "_" + field.key() + "=" + field.value().dump();
+            }
+            members.push_back(m);
+        }
+    }
+    if (members.empty())
+        members.push_back(defaults);
+    return members;
+}
+
+// État initial : scénario ou tirage reproductible (graine du membre) dans la boîte de simulation
+std::vector<Particle> EnsembleRunner::initialState(const EnsembleMember &member) const {
+    std::vector<Particle> particles;
+    Particle::id_counter = 0;
+    if (!member.scenario.empty()) {
+        std::ifstream in(member.scenario);
+        if (!in)
+            throw std::runtime_error("scénario introuvable : " + member.scenario);
+        json j = json::parse(in);
+        for (const auto &jp : j)
+            particles.push_back(Particle(jp.value("x", 0.f), jp.value("y", 0.f), jp.value("z", 0.f),
+                                         jp.value("vx", 0.f), jp.value("vy", 0.f), jp.value("vz", 0.f),
+                                         jp.value("mass", 1.f), jp.value("masseVolumique", 1.f), jp.value("colorHex", "")));
+        return particles;
+    }
+    boost::random::mt19937 gen(member.seed);
+    boost::random::uniform_real_distribution<float> posX(X_MIN, X_MAX), posY(Y_MIN, Y_MAX), posZ(Z_MIN, Z_MAX);
+    boost::random::uniform_real_distribution<float> velocity(vitesseMin, vitesseMax);
+    boost::random::uniform_real_distribution<float> mass(massMin, massMax);
+    particles.reserve(member.particles + 1);
+    for (int i = 0; i < member.particles; i++) {
+        float x = posX(gen), y = posY(gen), z = posZ(gen);
+        float vx = velocity(gen), vy = velocity(gen), vz = velocity(gen);
+        particles.push_back(Particle(x, y, z, vx, vy, vz, mass(gen)));
+    }
+    if (member.centralMass)
+        particles.push_back(Particle(0.5f * (X_MIN + X_MAX), 0.5f * (Y_MIN + Y_MAX), 0.5f * (Z_MIN + Z_MAX), 0.f, 0.f, 0.f, 1e13));
+    return particles;
+}
+
+// Coût estimé en interactions : N² en somme directe, N log N pour l'octree
+double EnsembleRunner::estimatedCost(const EnsembleMember &member, std::size_t n) const {
+    double steps = std::ceil(member.t_total / member.dt);
+    double perStep = static_cast<int>(n) <= directBelow ? static_cast<double>(n) * n
+                                                      : 30. * n * std::log2(static_cast<double>(std::max<std::size_t>(n, 2)));
+    return steps * perStep;
+}
+
+// Simulation complète d'un membre ; parallel : boucles réparties sur le pool
+EnsembleResult EnsembleRunner::simulate(const EnsembleMember &member, std::vector<Particle> &particles, bool parallel) const {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::size_t n = particles.size();
+    bool direct = static_cast<int>(n) <= directBelow;
+    int steps = static_cast<int>(std::ceil(member.t_total / member.dt));
+
+    Octree tree(X_MIN, Y_MIN, Z_MIN, X_MAX - X_MIN, Y_MAX - Y_MIN, Z_MAX - Z_MIN, 1);
+    tree.setTheta(member.theta);
+    std::vector<float> x(n), y(n), z(n), m(n);
+
+    auto force = [&](std::size_t i) {
+        particles[i].resetAcceleration();
+        if (direct) {
+            float ax = 0.f, ay = 0.f, az = 0.f;
+            directKernel(x[i], y[i], z[i], x.data(), y.data(), z.data(), m.data(), static_cast<int>(n), ax, ay, az);
+            particles[i].addAcceleration(Vector3D(ax, ay, az));
+        } else {
+            particles[i].addAcceleration(tree.computeAcceleration(particles[i]));
+        }
+    };
+    auto integrate = [&](std::size_t i) {
+        particles[i].updateVelocity(member.dt);
+        particles[i].updatePosition(member.dt);
+        particles[i].checkBoundary();
+    };
+
+    for (int s = 0; s < steps; s++) {
+        if (direct) {
+            for (std::size_t i = 0; i < n; i++) {
+                x[i] = particles[i].x();
+                y[i] = particles[i].y();
+                z[i] = particles[i].z();
+                m[i] = particles[i].getMass();
+            }
+        } else {
+            tree.build(particles);
+        }
+        if (parallel) {
+            pool.parallelFor(0, n, PARTICLE_GRAIN, force);
+            pool.parallelFor(0, n, PARTICLE_GRAIN, integrate);
+        } else {
+            for (std::size_t i = 0; i < n; i++)
+                force(i);
+            for (std::size_t i = 0; i < n; i++)
+                integrate(i);
+        }
+    }
+
+    EnsembleResult result;
+    result.name = member.name;
+    result.particles = n;
+    result.steps = steps;
+    result.direct = direct;
+    result.kinetic = 0.;
+    double mass = 0., cx = 0., cy = 0., cz = 0.;
+    for (const Particle &p : particles) {
+        Vector3D v = p.getVelocity();
+        result.kinetic += 0.5 * p.getMass() * (v.x * v.x + v.y * v.y + v.z * v.z);
+        mass += p.getMass();
+        cx += p.getMass() * p.x();
+        cy += p.getMass() * p.y();
+        cz += p.getMass() * p.z();
+    }
+    result.centerOfMass = mass > 0. ? Vector3D(cx / mass, cy / mass, cz / mass) : Vector3D();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void EnsembleRunner::writeState(const std::string &path, const std::vector<Particle> &particles) const {
+    std::ofstream out(path);
+    out << "id,x,y,z,vx,vy,vz,mass\n";
+    for (const Particle &p : particles) {
+        Vector3D v = p.getVelocity();
+        out << p.getId() << "," << p.x() << "," << p.y() << "," << p.z() << ","
+            << v.x << "," << v.y << "," << v.z << "," << p.getMass() << "\n";
+    }
+}
+
+// Exécute les membres et écrit outputDir/<membre>.csv (état final) et outputDir/summary.csv
+std::vector<EnsembleResult> EnsembleRunner::run(const std::vector<EnsembleMember> &members, const std::string &outputDir) {
+    // États initiaux construits ici (compteur d'identifiants global, non partagé entre threads)
+    std::vector<std::vector<Particle> > states;
+    std::vector<double> costs;
+    for (const EnsembleMember &member : members) {
+        states.push_back(initialState(member));
+        costs.push_back(estimatedCost(member, states.back().size()));
+    }
+
+    // Du plus coûteux au moins coûteux ; les petits membres sont regroupés en lots d'environ batchCost
+    std::vector<std::size_t> order(members.size());
+    for (std::size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&costs](std::size_t a, std::size_t b) { return costs[a] > costs[b]; });
+    std::vector<std::vector<std::size_t> > batches;
+    std::vector<bool> parallel;
+    double filled = batchCost;
+    for (std::size_t k : order) {
+        if (costs[k] >= batchCost) {
+            batches.push_back(std::vector<std::size_t>(1, k));
+            parallel.push_back(true);
+            continue;
+        }
+        if (filled + costs[k] > batchCost || parallel.empty() || parallel.back()) {
+            batches.push_back(std::vector<std::size_t>());
+            parallel.push_back(false);
+            filled = 0.;
+        }
+        batches.back().push_back(k);
+        filled += costs[k];
+    }
+
+    std::vector<EnsembleResult> results(members.size());
+    TaskGroup group;
+    for (std::size_t b = 0; b < batches.size(); b++) {
+        pool.spawn(group, [this, b, &batches, &parallel, &members, &states, &results]() {
+            for (std::size_t k : batches[b])
+                results[k] = simulate(members[k], states[k], parallel[b]);
+        });
+    }
+    pool.wait(group);
+
+    mkdir(outputDir.c_str(), 0755);
+    std::ofstream summary(outputDir + "/summary.csv");
+    summary << "name,particles,dt,theta,steps,mode,seconds,kinetic_energy,com_x,com_y,com_z\n";
+    for (std::size_t k = 0; k < members.size(); k++) {
+        const EnsembleResult &r = results[k];
+        writeState(outputDir + "/" + r.name + ".csv", states[k]);
+        summary << r.name << "," << r.particles << "," << members[k].dt << "," << members[k].theta << ","
+                << r.steps << "," << (r.direct ? "direct" : "octree") << "," << r.seconds << "," << r.kinetic << ","
+                << r.centerOfMass.x << "," << r.centerOfMass.y << "," << r.centerOfMass.z << "\n";
+    }
+    return results;
+}
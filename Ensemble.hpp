@@ -0,0 +1,63 @@
+#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+
+#include <vector>
+#include <string>
+
+#include "Particle.hpp"
+#include "TaskPool.hpp"
+
+// Variante d'une étude paramétrique
+struct EnsembleMember {
+    std::string name;
+    std::string scenario; // Fichier au format de POST /particles (vide : tirage aléatoire dans la boîte)
+    int particles;        // Nombre de particules tirées sans scénario
+    unsigned seed;        // Graine du tirage
+    bool centralMass;     // Corps massif au centre, comme initParticles
+    float dt;
+    float t_total;
+    float theta;          // Critère d'ouverture de l'octree
+};
+
+// Résultat d'un membre
+struct EnsembleResult {
+    std::string name;
+    std::size_t particles;
+    int steps;
+    bool direct;          // Sommation directe (petit système) plutôt qu'octree
+    double seconds;       // Durée de calcul du membre
+    double kinetic;       // Énergie cinétique finale
+    Vector3D centerOfMass;
+};
+
+// Exécution d'un ensemble de simulations indépendantes dans un seul processus
+//
+// Tous les membres partagent le pool de tâches. Les petits systèmes (coût estimé sous batchCost) sont
+// regroupés en lots exécutés chacun par une tâche, membre après membre sans parallélisme interne ; en
+// dessous de directBelow particules, les forces sont une somme directe sur des colonnes (noyau vectorisé,
+// toutes les voies SIMD occupées). Les grands systèmes sont des tâches à part qui parallélisent leurs
+// boucles. Les tâches sont lancées de la plus coûteuse à la moins coûteuse.
+class EnsembleRunner {
+public:
+    EnsembleRunner(TaskPool &pool, int directBelow, double batchCost);
+
+    // Membres d'un fichier JSON : "defaults", liste "members" et/ou "sweep" (produit cartésien des valeurs) ;
+    // lève std::runtime_error si le fichier est illisible
+    static std::vector<EnsembleMember> load(const std::string &path);
+
+    // Exécute les membres et écrit outputDir/<membre>.csv (état final) et outputDir/summary.csv
+    std::vector<EnsembleResult> run(const std::vector<EnsembleMember> &members, const std::string &outputDir);
+
+private:
+    TaskPool &pool;
+    int directBelow;
+    double batchCost;
+
+    std::vector<Particle> initialState(const EnsembleMember &member) const;
+    double estimatedCost(const EnsembleMember &member, std::size_t n) const;
+    // Simulation complète d'un membre ; parallel : boucles réparties sur le pool
+    EnsembleResult simulate(const EnsembleMember &member, std::vector<Particle> &particles, bool parallel) const;
+    void writeState(const std::string &path, const std::vector<Particle> &particles) const;
+};
+
+#endif // ENSEMBLE_HPP
@@ -0,0 +1,349 @@
+#include "FMMSolver.hpp"
+#include "Gravity.hpp"
+#include "TaskPool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+FMMSolver::FMMSolver(int order, float theta, int leafCapacity)
+    : order(0), theta(theta), leafCapacity(std::max(1, leafCapacity)),
+      tree(0.f, 0.f, 0.f, 1.f, 1.f, 1.f, std::max(1, leafCapacity)), base(nullptr), nbTerms(0) {
+    setOrder(order);
+}
+
+// Change l'ordre des développements (borné à [MIN_ORDER, MAX_ORDER])
+void FMMSolver::setOrder(int p) {
+    p = std::max(MIN_ORDER, std::min(MAX_ORDER, p));
+    if (p == order)
+        return;
+    order = p;
+    buildTables();
+}
+
+int FMMSolver::getOrder() const { return order; }
+
+int FMMSolver::term(int i, int j, int k) const {
+    return termIndex[(i * (order + 1) + j) * (order + 1) + k];
+}
+
+// Tables des multi-indices et des coefficients de translation pour l'ordre courant
+void FMMSolver::buildTables() {
+    int side = order + 1;
+    termIndex.assign(side * side * side, -1);
+    mx.clear(); my.clear(); mz.clear();
+    // Ordre gradué : tous les termes de degré s avant ceux de degré s + 1 (requis par la récurrence)
+    for (int s = 0; s <= order; s++) {
+        for (int i = s; i >= 0; i--) {
+            for (int j = s - i; j >= 0; j--) {
+                int k = s - i - j;
+                termIndex[(i * side + j) * side + k] = static_cast<int>(mx.size());
+                mx.push_back(i); my.push_back(j); mz.push_back(k);
+            }
+        }
+    }
+    nbTerms = static_cast<int>(mx.size());
+
+    std::vector<double> fact(2 * order + 1, 1.);
+    for (int i = 1; i <= 2 * order; i++)
+        fact[i] = fact[i - 1] * i;
+
+    // M2M : M_k(parent) += C(k, l) h^(k-l) M_l(enfant), l <= k
+    // L2L : L_m(enfant) += C(n, m) h^(n-m) L_n(parent), n >= m
+    m2mTable.clear();
+    l2lTable.clear();
+    for (int a = 0; a < nbTerms; a++) {
+        for (int b = 0; b < nbTerms; b++) {
+            if (mx[b] > mx[a] || my[b] > my[a] || mz[b] > mz[a])
+                continue;
+            double binom = fact[mx[a]] / (fact[mx[b]] * fact[mx[a] - mx[b]])
+                         * fact[my[a]] / (fact[my[b]] * fact[my[a] - my[b]])
+                         * fact[mz[a]] / (fact[mz[b]] * fact[mz[a] - mz[b]]);
+            int power = term(mx[a] - mx[b], my[a] - my[b], mz[a] - mz[b]);
+            Translation m2m = {a, b, power, binom};
+            Translation l2l = {b, a, power, binom};
+            m2mTable.push_back(m2m);
+            l2lTable.push_back(l2l);
+        }
+    }
+
+    // M2L : L_n += (-1)^|k| (n+k)! / (n! k!) T_(n+k) M_k, |n| + |k| <= p
+    m2lTable.clear();
+    for (int n = 0; n < nbTerms; n++) {
+        for (int k = 0; k < nbTerms; k++) {
+            int degree = mx[n] + my[n] + mz[n] + mx[k] + my[k] + mz[k];
+            if (degree > order)
+                continue;
+            double coef = fact[mx[n] + mx[k]] / (fact[mx[n]] * fact[mx[k]])
+                        * fact[my[n] + my[k]] / (fact[my[n]] * fact[my[k]])
+                        * fact[mz[n] + mz[k]] / (fact[mz[n]] * fact[mz[k]]);
+            if ((mx[k] + my[k] + mz[k]) % 2 == 1)
+                coef = -coef;
+            M2LTerm t = {n, k, term(mx[n] + mx[k], my[n] + my[k], mz[n] + mz[k]), coef};
+            m2lTable.push_back(t);
+        }
+    }
+}
+
+// Coefficients de Taylor T_m = D^m (r^2 + eps^2)^(-1/2) / m! au point (dx, dy, dz), par la récurrence
+// |m| r^2 T_m + (2|m| - 1) sum_i d_i T_(m - e_i) + (|m| - 1) sum_i T_(m - 2 e_i) = 0
+void FMMSolver::derivatives(double dx, double dy, double dz, double *t) const {
+    double r2 = dx * dx + dy * dy + dz * dz + epsilon_sq;
+    t[0] = 1. / std::sqrt(r2);
+    for (int m = 1; m < nbTerms; m++) {
+        int i = mx[m], j = my[m], k = mz[m];
+        int s = i + j + k;
+        double first = 0., second = 0.;
+        if (i > 0) first += dx * t[term(i - 1, j, k)];
+        if (j > 0) first += dy * t[term(i, j - 1, k)];
+        if (k > 0) first += dz * t[term(i, j, k - 1)];
+        if (i > 1) second += t[term(i - 2, j, k)];
+        if (j > 1) second += t[term(i, j - 2, k)];
+        if (k > 1) second += t[term(i, j, k - 2)];
+        t[m] = -((2 * s - 1) * first + (s - 1) * second) / (s * r2);
+    }
+}
+
+// Puissances h^m de tous les multi-indices
+void FMMSolver::powers(double hx, double hy, double hz, double *out) const {
+    double px[MAX_ORDER + 1], py[MAX_ORDER + 1], pz[MAX_ORDER + 1];
+    px[0] = py[0] = pz[0] = 1.;
+    for (int i = 1; i <= order; i++) {
+        px[i] = px[i - 1] * hx;
+        py[i] = py[i - 1] * hy;
+        pz[i] = pz[i - 1] * hz;
+    }
+    for (int m = 0; m < nbTerms; m++)
+        out[m] = px[mx[m]] * py[my[m]] * pz[mz[m]];
+}
+
+// Libère l'octree et les développements
+void FMMSolver::clear() {
+    tree.clear();
+    cells.clear();
+    leaves.clear();
+    multipoles.clear();
+    locals.clear();
+}
+
+// Enregistre la cellule (et son sous-arbre) en ordre préfixe, renvoie son indice
+int FMMSolver::addCell(const Octree *node) {
+    int index = static_cast<int>(cells.size());
+    cells.push_back(Cell());
+
+    Cell c;
+    c.center = Vector3D(node->x + 0.5f * node->width, node->y + 0.5f * node->height, node->z + 0.5f * node->depth);
+    c.radius = 0.5f * std::sqrt(node->width * node->width + node->height * node->height + node->depth * node->depth);
+    c.childCount = 0;
+    c.begin = static_cast<int>(node->begin);
+    c.count = static_cast<int>(node->count);
+    if (node->leaf) {
+        leaves.push_back(index);
+    } else {
+        // Seuls les octants non vides existent : l'ordre préfixe suit celui des colonnes triées
+        for (int j = 0; j < 8; j++) {
+            if (node->children[j] != nullptr)
+                c.children[c.childCount++] = addCell(node->children[j]);
+        }
+    }
+    cells[index] = c;
+    return index;
+}
+
+// Construit l'octree puis calcule l'accélération de toutes les particules (passes montante, M2L, descendante)
+void FMMSolver::build(const std::vector<Particle> &particles) {
+    clear();
+    base = particles.data();
+    accelerations.assign(particles.size(), Vector3D(0.f, 0.f, 0.f));
+    if (particles.empty())
+        return;
+
+    // Cube englobant toutes les particules : aucune n'est perdue à l'insertion
+    float lo[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    float hi[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+    for (const auto &p : particles) {
+        lo[0] = std::min(lo[0], p.x()); hi[0] = std::max(hi[0], p.x());
+        lo[1] = std::min(lo[1], p.y()); hi[1] = std::max(hi[1], p.y());
+        lo[2] = std::min(lo[2], p.z()); hi[2] = std::max(hi[2], p.z());
+    }
+    float extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+    float cube = extent * 1.01f + 1e-3f;
+    tree.updateAttributes(0.5f * (lo[0] + hi[0]) - 0.5f * cube, 0.5f * (lo[1] + hi[1]) - 0.5f * cube,
+                          0.5f * (lo[2] + hi[2]) - 0.5f * cube, cube, cube, cube, leafCapacity);
+    tree.build(particles);
+
+    addCell(&tree);
+
+    multipoles.assign(cells.size() * nbTerms, 0.);
+    locals.assign(cells.size() * nbTerms, 0.);
+
+    upwardPass(0);
+    interact(0, 0);
+    computeLocals();
+    downwardPass(0);
+    evaluateLeaves();
+}
+
+// P2M aux feuilles puis M2M des enfants vers le parent ; les gros sous-arbres sont calculés en tâches
+// (chaque tâche n'écrit que les multipôles de son sous-arbre)
+void FMMSolver::upwardPass(int c) {
+    const ArenaVector<float> &px = tree.sortedX, &py = tree.sortedY, &pz = tree.sortedZ, &pm = tree.sortedMass;
+    const Cell &cell = cells[c];
+    double *M = &multipoles[c * nbTerms];
+    double pw[MAX_TERMS];
+    if (cell.childCount == 0) {
+        for (int i = cell.begin; i < cell.begin + cell.count; i++) {
+            powers(px[i] - cell.center.x, py[i] - cell.center.y, pz[i] - cell.center.z, pw);
+            for (int m = 0; m < nbTerms; m++)
+                M[m] += pm[i] * pw[m];
+        }
+        return;
+    }
+    TaskPool &pool = TaskPool::global();
+    TaskGroup group;
+    for (int j = 0; j < cell.childCount; j++) {
+        int child = cell.children[j];
+        if (cells[child].count >= TASK_GRAIN)
+            pool.spawn(group, [this, child]() { upwardPass(child); });
+        else
+            upwardPass(child);
+    }
+    pool.wait(group);
+    for (int j = 0; j < cell.childCount; j++) {
+        const Cell &child = cells[cell.children[j]];
+        const double *Mc = &multipoles[cell.children[j] * nbTerms];
+        powers(child.center.x - cell.center.x, child.center.y - cell.center.y, child.center.z - cell.center.z, pw);
+        for (const Translation &t : m2mTable)
+            M[t.target] += t.coef * pw[t.power] * Mc[t.source];
+    }
+}
+
+// Traversée double arbre : classe chaque paire (cible, source) en M2L ou en champ proche
+// Toutes les paires d'une cible restent dans le sous-arbre de la cible de départ : pour une grosse cellule,
+// les paires de chaque enfant cible sont traitées dans une tâche (listes m2l et p2p disjointes)
+void FMMSolver::interact(int target, int source) {
+    const Cell &a = cells[target];
+    const Cell &b = cells[source];
+    if (target == source) {
+        if (a.childCount == 0) {
+            cells[target].p2p.push_back(source);
+            return;
+        }
+        TaskPool &pool = TaskPool::global();
+        TaskGroup group;
+        for (int i = 0; i < a.childCount; i++) {
+            int child = a.children[i];
+            auto pairs = [this, &a, child]() {
+                for (int j = 0; j < a.childCount; j++)
+                    interact(child, a.children[j]);
+            };
+            if (cells[child].count >= TASK_GRAIN)
+                pool.spawn(group, pairs);
+            else
+                pairs();
+        }
+        pool.wait(group);
+        return;
+    }
+
+    Vector3D d = a.center - b.center;
+    if (a.radius + b.radius < theta * d.norm()) {
+        cells[target].m2l.push_back(source);
+        return;
+    }
+    if (a.childCount == 0 && b.childCount == 0) {
+        cells[target].p2p.push_back(source);
+        return;
+    }
+    // On descend dans la plus grande des deux cellules
+    if (b.childCount == 0 || (a.childCount > 0 && a.radius >= b.radius)) {
+        for (int i = 0; i < a.childCount; i++)
+            interact(a.children[i], source);
+    } else {
+        for (int j = 0; j < b.childCount; j++)
+            interact(target, b.children[j]);
+    }
+}
+
+// Translations multipôle -> local de chaque cellule cible, par blocs de cellules sur le pool
+void FMMSolver::computeLocals() {
+    TaskPool::global().parallelFor(0, cells.size(), 16, [this](std::size_t c) {
+        const Cell &cell = cells[c];
+        double *L = &locals[c * nbTerms];
+        double t[MAX_TERMS];
+        for (int s : cell.m2l) {
+            const Cell &src = cells[s];
+            const double *M = &multipoles[s * nbTerms];
+            derivatives(cell.center.x - src.center.x, cell.center.y - src.center.y, cell.center.z - src.center.z, t);
+            for (const M2LTerm &term : m2lTable)
+                L[term.target] += term.coef * M[term.source] * t[term.derivative];
+        }
+    });
+}
+
+// L2L de la cellule vers ses enfants, puis descente dans leurs sous-arbres (gros sous-arbres en tâches) :
+// le développement local d'une cellule est complet avant d'être translaté
+void FMMSolver::downwardPass(int c) {
+    const Cell &cell = cells[c];
+    const double *L = &locals[c * nbTerms];
+    double pw[MAX_TERMS];
+    TaskPool &pool = TaskPool::global();
+    TaskGroup group;
+    for (int j = 0; j < cell.childCount; j++) {
+        int index = cell.children[j];
+        const Cell &child = cells[index];
+        double *Lc = &locals[index * nbTerms];
+        powers(child.center.x - cell.center.x, child.center.y - cell.center.y, child.center.z - cell.center.z, pw);
+        for (const Translation &t : l2lTable)
+            Lc[t.target] += t.coef * pw[t.power] * L[t.source];
+        if (child.count >= TASK_GRAIN)
+            pool.spawn(group, [this, index]() { downwardPass(index); });
+        else
+            downwardPass(index);
+    }
+    pool.wait(group);
+}
+
+// L2P (gradient du développement local) et champ proche avec le noyau direct, par blocs de feuilles sur le pool
+void FMMSolver::evaluateLeaves() {
+    const ArenaVector<float> &px = tree.sortedX, &py = tree.sortedY, &pz = tree.sortedZ, &pm = tree.sortedMass;
+    TaskPool::global().parallelFor(0, leaves.size(), 8, [&](std::size_t l) {
+        const Cell &cell = cells[leaves[l]];
+        const double *L = &locals[leaves[l] * nbTerms];
+        for (int i = cell.begin; i < cell.begin + cell.count; i++) {
+            double ex[MAX_ORDER + 1], ey[MAX_ORDER + 1], ez[MAX_ORDER + 1];
+            ex[0] = ey[0] = ez[0] = 1.;
+            for (int k = 1; k <= order; k++) {
+                ex[k] = ex[k - 1] * (px[i] - cell.center.x);
+                ey[k] = ey[k - 1] * (py[i] - cell.center.y);
+                ez[k] = ez[k - 1] * (pz[i] - cell.center.z);
+            }
+            double gx = 0., gy = 0., gz = 0.;
+            for (int m = 1; m < nbTerms; m++) {
+                if (mx[m] > 0) gx += L[m] * mx[m] * ex[mx[m] - 1] * ey[my[m]] * ez[mz[m]];
+                if (my[m] > 0) gy += L[m] * my[m] * ex[mx[m]] * ey[my[m] - 1] * ez[mz[m]];
+                if (mz[m] > 0) gz += L[m] * mz[m] * ex[mx[m]] * ey[my[m]] * ez[mz[m] - 1];
+            }
+            float ax = static_cast<float>(G * gx), ay = static_cast<float>(G * gy), az = static_cast<float>(G * gz);
+            for (int s : cell.p2p) {
+                const Cell &src = cells[s];
+                directKernel(px[i], py[i], pz[i], &px[src.begin], &py[src.begin], &pz[src.begin], &pm[src.begin],
+                             src.count, ax, ay, az);
+            }
+            accelerations[tree.sortedIndex[i]] = Vector3D(ax, ay, az);
+        }
+    });
+}
+
+// Renvoie l'accélération calculée lors du dernier build pour cette particule
+Vector3D FMMSolver::computeAcceleration(const Particle &p) const {
+    std::ptrdiff_t index = &p - base;
+    if (base == nullptr || index < 0 || index >= static_cast<std::ptrdiff_t>(accelerations.size()))
+        return Vector3D(0.f, 0.f, 0.f);
+    return accelerations[index];
+}
+
+// Affichage 3D de l'octree sous-jacent
+void FMMSolver::drawGL() const {
+    tree.drawGL();
+}
@@ -0,0 +1,90 @@
+#ifndef FMMSOLVER_H
+#define FMMSOLVER_H
+
+#include <vector>
+
+#include "Particle.hpp"
+#include "Octree.hpp"
+
+// Méthode multipôle rapide (FMM) sur la hiérarchie de l'octree
+//
+// Développements de Taylor cartésiens d'ordre p (choisi à l'exécution) autour des centres des cellules :
+// P2M/M2M en montée, traversée double arbre (cible, source) avec translations multipôle -> local (M2L),
+// L2L en descente puis L2P. Le champ proche est évalué avec le noyau direct vectorisé (directKernel).
+// Le coût est en O(N) ; l'erreur se règle par p indépendamment du critère d'ouverture theta de la traversée.
+// Toutes les passes tournent sur le pool de tâches partagé : sous-arbres en tâches pour les passes montante,
+// descendante et la traversée, boucles réparties pour M2L et L2P.
+class FMMSolver {
+public:
+    static const int MIN_ORDER = 1;
+    static const int MAX_ORDER = 10;
+
+    FMMSolver(int order = 4, float theta = 0.7f, int leafCapacity = 32);
+
+    // Change l'ordre des développements (borné à [MIN_ORDER, MAX_ORDER])
+    void setOrder(int p);
+    int getOrder() const;
+    // Construit l'octree puis calcule l'accélération de toutes les particules (passes montante, M2L, descendante)
+    void build(const std::vector<Particle> &particles);
+    // Renvoie l'accélération calculée lors du dernier build pour cette particule
+    Vector3D computeAcceleration(const Particle &p) const;
+    // Libère l'octree et les développements
+    void clear();
+    // Affichage 3D de l'octree sous-jacent
+    void drawGL() const;
+
+private:
+    // Nombre maximal de termes (i + j + k <= MAX_ORDER)
+    static const int MAX_TERMS = (MAX_ORDER + 1) * (MAX_ORDER + 2) * (MAX_ORDER + 3) / 6;
+    // Sous-arbres d'au moins TASK_GRAIN particules traités en tâches du pool
+    static const int TASK_GRAIN = 4096;
+
+    struct Cell {
+        Vector3D center;  // Centre géométrique (centre des développements)
+        float radius;     // Demi-diagonale de la cellule
+        int children[8];
+        int childCount;
+        int begin, count; // Intervalle des particules du sous-arbre dans les colonnes triées de l'octree
+        std::vector<int> m2l; // Cellules sources bien séparées (M2L)
+        std::vector<int> p2p; // Feuilles sources voisines (champ proche)
+    };
+
+    int order;
+    float theta;
+    int leafCapacity;
+    Octree tree;
+
+    std::vector<Cell> cells;
+    std::vector<int> leaves;
+    const Particle *base;
+    std::vector<Vector3D> accelerations;
+
+    // Développements multipôles et locaux : nbTerms coefficients par cellule
+    std::vector<double> multipoles, locals;
+
+    // Tables des multi-indices (i, j, k) avec i + j + k <= order
+    int nbTerms;
+    std::vector<int> mx, my, mz;  // Exposants de chaque terme (ordre gradué)
+    std::vector<int> termIndex;   // (i, j, k) -> indice du terme, -1 si hors ordre
+    struct Translation { int target, source, power; double coef; };
+    std::vector<Translation> m2mTable, l2lTable;
+    struct M2LTerm { int target, source, derivative; double coef; };
+    std::vector<M2LTerm> m2lTable;
+
+    void buildTables();
+    int term(int i, int j, int k) const;
+    int addCell(const Octree *node);
+    void interact(int target, int source);
+    // P2M/M2M du sous-arbre de la cellule c (enfants avant le parent)
+    void upwardPass(int c);
+    void computeLocals();
+    // L2L de la cellule c vers ses enfants puis dans leurs sous-arbres
+    void downwardPass(int c);
+    void evaluateLeaves();
+    // Coefficients de Taylor T_m = D^m (r^2 + eps^2)^(-1/2) / m! au point (dx, dy, dz)
+    void derivatives(double dx, double dy, double dz, double *t) const;
+    // Puissances h^m de tous les multi-indices
+    void powers(double hx, double hy, double hz, double *out) const;
+};
+
+#endif // FMMSOLVER_H
@@ -0,0 +1,37 @@
+#ifndef GRAVITY_HPP
+#define GRAVITY_HPP
+
+#include <cmath>
+
+// Constantes physiques partagées par les solveurs (Octree, Quadtree)
+constexpr float G = 6.67430e-11f; // Constante gravitationnelle
+constexpr float theta = 0.5f;     // Seuil d'approximation Barnes-Hut
+constexpr float epsilon = 0.001f; // Facteur d'adoucissement
+
+constexpr float epsilon_sq = epsilon * epsilon;
+constexpr float theta_sq = theta * theta;
+
+// Noyau direct : accumule dans (ax, ay, az) l'accélération exercée en (px, py, pz)
+// par les sources [0, n) rangées en colonnes (SoA). La boucle est vectorisée (omp simd) ;
+// l'auto-interaction est nulle grâce à l'adoucissement (dx = dy = dz = 0), pas de test de soi.
+inline void directKernel(float px, float py, float pz,
+                         const float *sx, const float *sy, const float *sz, const float *sm, int n,
+                         float &ax, float &ay, float &az) {
+    float accX = 0.f, accY = 0.f, accZ = 0.f;
+    #pragma omp simd reduction(+:accX, accY, accZ)
+    for (int j = 0; j < n; j++) {
+        float dx = sx[j] - px;
+        float dy = sy[j] - py;
+        float dz = sz[j] - pz;
+        float dist_sq_eps = dx * dx + dy * dy + dz * dz + epsilon_sq;
+        float invDistCube = G * sm[j] / (dist_sq_eps * std::sqrt(dist_sq_eps));
+        accX += dx * invDistCube;
+        accY += dy * invDistCube;
+        accZ += dz * invDistCube;
+    }
+    ax += accX;
+    ay += accY;
+    az += accZ;
+}
+
+#endif // GRAVITY_HPP
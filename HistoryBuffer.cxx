@@ -0,0 +1,100 @@
+#include "HistoryBuffer.hpp"
+#include "TaskPool.hpp"
+
+#include <algorithm>
+
+HistoryBuffer::HistoryBuffer() : published(std::make_shared<const HistoryView>()) {}
+
+// Vue publiée courante (lecture sans verrou)
+std::shared_ptr<const HistoryView> HistoryBuffer::view() const {
+    return std::atomic_load(&published);
+}
+
+// Trame à remplir : une trame libre recyclée ou une nouvelle
+std::shared_ptr<HistoryFrame> HistoryBuffer::acquireFrame(std::size_t n) {
+    std::shared_ptr<HistoryFrame> frame;
+    // Une trame n'est réutilisable que si plus aucune vue (donc aucun lecteur) ne la référence
+    for (std::size_t i = 0; i < spare.size(); i++) {
+        if (spare[i].use_count() == 1) {
+            frame = spare[i];
+            spare.erase(spare.begin() + i);
+            break;
+        }
+    }
+    if (!frame)
+        frame = std::make_shared<HistoryFrame>();
+    arenaResize(frame->x, n); arenaResize(frame->y, n); arenaResize(frame->z, n);
+    arenaResize(frame->vx, n); arenaResize(frame->vy, n); arenaResize(frame->vz, n);
+    return frame;
+}
+
+void HistoryBuffer::publish(const std::shared_ptr<const HistoryView> &view, const HistoryView &dropped) {
+    std::atomic_store(&published, view);
+    for (const auto &frame : dropped)
+        spare.push_back(std::const_pointer_cast<HistoryFrame>(frame));
+    // Borne la réserve : au-delà, les trames tenues par des lecteurs lents sont simplement libérées
+    if (spare.size() > 8)
+        spare.erase(spare.begin(), spare.end() - 8);
+}
+
+// Ajoute l'état des particules au temps time et retire les trames plus vieilles que maxAge (-1 : illimité)
+void HistoryBuffer::record(const std::vector<Particle> &particles, float time, float maxAge) {
+    std::lock_guard<std::mutex> lock(writerMtx);
+    std::size_t n = particles.size();
+    std::shared_ptr<HistoryFrame> frame = acquireFrame(n);
+    frame->time = time;
+    HistoryFrame &f = *frame;
+    TaskPool::global().parallelFor(0, n, 4096, [&](std::size_t i) {
+        const Vector3D v = particles[i].getVelocity();
+        f.x[i] = particles[i].x();
+        f.y[i] = particles[i].y();
+        f.z[i] = particles[i].z();
+        f.vx[i] = v.x;
+        f.vy[i] = v.y;
+        f.vz[i] = v.z;
+    });
+
+    std::shared_ptr<const HistoryView> current = std::atomic_load(&published);
+    std::shared_ptr<HistoryView> next = std::make_shared<HistoryView>();
+    HistoryView dropped;
+    next->reserve(current->size() + 1);
+    for (const auto &old : *current) {
+        if (maxAge != -1 && time - old->time > maxAge)
+            dropped.push_back(old);
+        else
+            next->push_back(old);
+    }
+    next->push_back(frame);
+    publish(next, dropped);
+}
+
+// Restaure positions et vitesses de la dernière trame <= time (ou de la plus ancienne)
+bool HistoryBuffer::rewind(std::vector<Particle> &particles, float time) {
+    std::lock_guard<std::mutex> lock(writerMtx);
+    std::shared_ptr<const HistoryView> current = std::atomic_load(&published);
+    if (current->empty())
+        return false;
+    std::size_t keep = 1;
+    for (std::size_t k = current->size(); k > 0; k--) {
+        if ((*current)[k - 1]->time <= time) {
+            keep = k;
+            break;
+        }
+    }
+    const HistoryFrame &frame = *(*current)[keep - 1];
+    std::size_t n = std::min(frame.size(), particles.size());
+    for (std::size_t i = 0; i < n; i++) {
+        particles[i].setPosition(Vector3D(frame.x[i], frame.y[i], frame.z[i]));
+        particles[i].setVelocity(Vector3D(frame.vx[i], frame.vy[i], frame.vz[i]));
+    }
+    std::shared_ptr<HistoryView> next = std::make_shared<HistoryView>(current->begin(), current->begin() + keep);
+    publish(next, HistoryView(current->begin() + keep, current->end()));
+    return true;
+}
+
+// Oublie tout l'historique (changement de l'ensemble des particules)
+void HistoryBuffer::clear() {
+    std::lock_guard<std::mutex> lock(writerMtx);
+    std::shared_ptr<const HistoryView> current = std::atomic_load(&published);
+    publish(std::make_shared<const HistoryView>(), *current);
+}
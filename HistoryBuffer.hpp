@@ -0,0 +1,52 @@
+#ifndef HISTORYBUFFER_H
+#define HISTORYBUFFER_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include "Particle.hpp"
+#include "Arena.hpp"
+
+// État de toutes les particules à un instant, rangé en colonnes (indice = position dans le vecteur de particules)
+struct HistoryFrame {
+    float time;
+    ArenaVector<float> x, y, z, vx, vy, vz; // Remplies en parallèle (premier contact réparti)
+    std::size_t size() const { return x.size(); }
+};
+
+// Historique publié : fenêtre des états, du plus ancien au plus récent (immuable une fois publié)
+typedef std::vector<std::shared_ptr<const HistoryFrame> > HistoryView;
+
+// Historique des états par pas en colonnes, sans verrou par particule
+//
+// L'enregistrement d'un pas recopie positions et vitesses dans une trame préallouée (recyclée quand plus
+// aucun lecteur ne la tient), puis publie atomiquement une nouvelle vue de la fenêtre. Les lecteurs
+// (API) obtiennent une vue cohérente sans verrou ; seuls les écrivains (simulation, rembobinage)
+// se synchronisent entre eux.
+class HistoryBuffer {
+public:
+    HistoryBuffer();
+
+    // Ajoute l'état des particules au temps time et retire les trames plus vieilles que maxAge (-1 : illimité)
+    void record(const std::vector<Particle> &particles, float time, float maxAge);
+    // Restaure positions et vitesses de la dernière trame <= time (ou de la plus ancienne) et oublie
+    // les trames postérieures ; renvoie faux si aucune trame n'est utilisable
+    bool rewind(std::vector<Particle> &particles, float time);
+    // Oublie tout l'historique (changement de l'ensemble des particules)
+    void clear();
+
+    // Vue publiée courante (lecture sans verrou)
+    std::shared_ptr<const HistoryView> view() const;
+
+private:
+    std::shared_ptr<const HistoryView> published; // Accédé par std::atomic_load / std::atomic_store
+    std::vector<std::shared_ptr<HistoryFrame> > spare; // Trames sorties de la fenêtre, réutilisables
+    std::mutex writerMtx;
+
+    // Trame à remplir : une trame libre recyclée ou une nouvelle
+    std::shared_ptr<HistoryFrame> acquireFrame(std::size_t n);
+    void publish(const std::shared_ptr<const HistoryView> &view, const HistoryView &dropped);
+};
+
+#endif // HISTORYBUFFER_H
@@ -0,0 +1,194 @@
+#include "InteractionCache.hpp"
+#include "Gravity.hpp"
+#include "TaskPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+// Particules par tâche du test de déplacement
+static const std::size_t MOVE_GRAIN = 4096;
+
+InteractionCache::InteractionCache(int maxReuse, float margin, int groupSize, int leafCapacity)
+    : maxReuse(std::max(0, maxReuse)), margin(std::max(0.f, margin)), groupSize(std::max(1, groupSize)),
+      leafCapacity(std::max(1, leafCapacity)), tree(0.f, 0.f, 0.f, 1.f, 1.f, 1.f, std::max(1, leafCapacity)),
+      marginAbs(0.f), age(0), rebuilds(0), reuses(0), base(nullptr) {}
+
+// Reconstruit ou rafraîchit l'octree puis calcule l'accélération de toutes les particules
+void InteractionCache::build(const std::vector<Particle> &particles) {
+    if (reusable(particles)) {
+        tree.refresh(particles);
+        age++;
+        reuses++;
+    } else {
+        rebuild(particles);
+    }
+    evaluate();
+}
+
+// Vrai si les listes peuvent encore servir pour ces positions
+bool InteractionCache::reusable(const std::vector<Particle> &particles) const {
+    if (groups.empty() || age >= maxReuse || particles.data() != base || particles.size() != x0.size())
+        return false;
+    // Une particule déplacée de plus de la marge depuis la construction suffit à invalider les listes
+    float limitSq = marginAbs * marginAbs;
+    std::atomic<bool> moved(false);
+    TaskPool::global().parallelFor(0, particles.size(), MOVE_GRAIN, [&](std::size_t i) {
+        float dx = particles[i].x() - x0[i];
+        float dy = particles[i].y() - y0[i];
+        float dz = particles[i].z() - z0[i];
+        if (dx * dx + dy * dy + dz * dz > limitSq)
+            moved.store(true, std::memory_order_relaxed);
+    });
+    return !moved.load();
+}
+
+// Reconstruit l'octree, les groupes et leurs listes
+void InteractionCache::rebuild(const std::vector<Particle> &particles) {
+    clear();
+    base = particles.data();
+    rebuilds++;
+    if (particles.empty())
+        return;
+
+    // Cube englobant toutes les particules : aucune n'est perdue à l'insertion
+    float lo[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    float hi[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+    for (const auto &p : particles) {
+        lo[0] = std::min(lo[0], p.x()); hi[0] = std::max(hi[0], p.x());
+        lo[1] = std::min(lo[1], p.y()); hi[1] = std::max(hi[1], p.y());
+        lo[2] = std::min(lo[2], p.z()); hi[2] = std::max(hi[2], p.z());
+    }
+    float extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+    float cube = extent * 1.01f + 1e-3f;
+    tree.updateAttributes(0.5f * (lo[0] + hi[0]) - 0.5f * cube, 0.5f * (lo[1] + hi[1]) - 0.5f * cube,
+                          0.5f * (lo[2] + hi[2]) - 0.5f * cube, cube, cube, cube, leafCapacity);
+    tree.setWideTraversal(false);
+    tree.build(particles);
+    marginAbs = margin * cube;
+
+    std::size_t n = particles.size();
+    x0.resize(n); y0.resize(n); z0.resize(n);
+    for (std::size_t i = 0; i < n; i++) {
+        x0[i] = particles[i].x();
+        y0[i] = particles[i].y();
+        z0[i] = particles[i].z();
+    }
+
+    uint32_t flatIndex = 0;
+    collectGroups(&tree, flatIndex);
+
+    // Parcours des groupes en tâches sur le pool à vol de travail
+    TaskPool::global().parallelFor(0, groups.size(), 4, [this](std::size_t g) { buildList(groups[g]); });
+}
+
+// Découpe le sous-arbre en groupes ; flatIndex suit l'ordre préfixe du tableau aplati
+void InteractionCache::collectGroups(const Octree *node, uint32_t &flatIndex) {
+    if (node->leaf || node->count <= static_cast<uint32_t>(groupSize)) {
+        Group group;
+        group.begin = node->begin;
+        group.count = node->count;
+        for (int k = 0; k < 3; k++) {
+            group.lo[k] = std::numeric_limits<float>::max();
+            group.hi[k] = std::numeric_limits<float>::lowest();
+        }
+        for (uint32_t i = node->begin; i < node->begin + node->count; i++) {
+            group.lo[0] = std::min(group.lo[0], tree.sortedX[i]); group.hi[0] = std::max(group.hi[0], tree.sortedX[i]);
+            group.lo[1] = std::min(group.lo[1], tree.sortedY[i]); group.hi[1] = std::max(group.hi[1], tree.sortedY[i]);
+            group.lo[2] = std::min(group.lo[2], tree.sortedZ[i]); group.hi[2] = std::max(group.hi[2], tree.sortedZ[i]);
+        }
+        groups.push_back(group);
+        flatIndex = tree.flatNodes[flatIndex].next;
+        return;
+    }
+    flatIndex++;
+    for (int j = 0; j < 8; j++) {
+        if (node->children[j] != nullptr)
+            collectGroups(node->children[j], flatIndex);
+    }
+}
+
+// Parcours du tableau aplati avec le critère élargi : la distance du centre de masse à la boîte du groupe
+// est diminuée de deux marges (déplacement des particules du groupe et du centre de masse du nœud)
+void InteractionCache::buildList(Group &group) const {
+    const InterleavedVector<Octree::FlatNode> &nodes = tree.flatNodes;
+    uint32_t nbNodes = static_cast<uint32_t>(nodes.size());
+    float slack = 2.f * marginAbs;
+    uint32_t i = 0;
+    while (i < nbNodes) {
+        const Octree::FlatNode &node = nodes[i];
+        float dx = std::max(0.f, std::max(group.lo[0] - node.comX, node.comX - group.hi[0]));
+        float dy = std::max(0.f, std::max(group.lo[1] - node.comY, node.comY - group.hi[1]));
+        float dz = std::max(0.f, std::max(group.lo[2] - node.comZ, node.comZ - group.hi[2]));
+        float dist = std::max(0.f, std::sqrt(dx * dx + dy * dy + dz * dz) - slack);
+        if (node.sizeSq < theta_sq * (dist * dist + epsilon_sq)) {
+            group.list.push_back(i);
+            i = node.next;
+        } else {
+            i++;
+        }
+    }
+}
+
+// Somme des monopôles de la liste pour chaque particule du groupe : les sources (centres de masse des nœuds
+// acceptés et particules des feuilles directes) sont rassemblées une fois par groupe en colonnes
+// puis passées au noyau direct vectorisé
+void InteractionCache::evaluate() {
+    accelerations.assign(x0.size(), Vector3D(0.f, 0.f, 0.f));
+    const InterleavedVector<Octree::FlatNode> &nodes = tree.flatNodes;
+    const ArenaVector<float> &px = tree.sortedX, &py = tree.sortedY, &pz = tree.sortedZ, &pm = tree.sortedMass;
+    // Groupes évalués en tâches sur le pool à vol de travail
+    TaskPool::global().parallelFor(0, groups.size(), 4, [&](std::size_t g) {
+        // Colonnes de sources propres au thread (réutilisées d'un groupe à l'autre)
+        static thread_local std::vector<float> sx, sy, sz, sm;
+        const Group &group = groups[g];
+        sx.clear(); sy.clear(); sz.clear(); sm.clear();
+        for (uint32_t c : group.list) {
+            const Octree::FlatNode &node = nodes[c];
+            if (node.leafCount > 1) {
+                sx.insert(sx.end(), px.begin() + node.begin, px.begin() + node.begin + node.leafCount);
+                sy.insert(sy.end(), py.begin() + node.begin, py.begin() + node.begin + node.leafCount);
+                sz.insert(sz.end(), pz.begin() + node.begin, pz.begin() + node.begin + node.leafCount);
+                sm.insert(sm.end(), pm.begin() + node.begin, pm.begin() + node.begin + node.leafCount);
+            } else {
+                sx.push_back(node.comX);
+                sy.push_back(node.comY);
+                sz.push_back(node.comZ);
+                sm.push_back(node.mass);
+            }
+        }
+        int nbSources = static_cast<int>(sx.size());
+        for (uint32_t i = group.begin; i < group.begin + group.count; i++) {
+            float ax = 0.f, ay = 0.f, az = 0.f;
+            directKernel(px[i], py[i], pz[i], sx.data(), sy.data(), sz.data(), sm.data(), nbSources, ax, ay, az);
+            accelerations[tree.sortedIndex[i]] = Vector3D(ax, ay, az);
+        }
+    });
+}
+
+// Renvoie l'accélération calculée lors du dernier build pour cette particule
+Vector3D InteractionCache::computeAcceleration(const Particle &p) const {
+    std::ptrdiff_t index = &p - base;
+    if (base == nullptr || index < 0 || index >= static_cast<std::ptrdiff_t>(accelerations.size()))
+        return Vector3D(0.f, 0.f, 0.f);
+    return accelerations[index];
+}
+
+// Libère l'octree et les listes (force la prochaine reconstruction)
+void InteractionCache::clear() {
+    tree.clear();
+    groups.clear();
+    x0.clear(); y0.clear(); z0.clear();
+    accelerations.clear();
+    age = 0;
+    base = nullptr;
+}
+
+long InteractionCache::rebuildCount() const { return rebuilds; }
+long InteractionCache::reuseCount() const { return reuses; }
+
+// Affichage 3D de l'octree sous-jacent
+void InteractionCache::drawGL() const {
+    tree.drawGL();
+}
@@ -0,0 +1,69 @@
+#ifndef INTERACTIONCACHE_H
+#define INTERACTIONCACHE_H
+
+#include <vector>
+#include <cstdint>
+
+#include "Particle.hpp"
+#include "Octree.hpp"
+
+// Réutilisation temporelle des listes d'interaction Barnes-Hut
+//
+// Les particules sont regroupées en sous-arbres d'au plus groupSize particules. Pour chaque groupe, la liste
+// des nœuds acceptés (monopôles) est calculée une fois avec un critère d'ouverture élargi d'une marge : la boîte
+// du groupe est gonflée de la marge et la distance aux centres de masse en est diminuée. Tant qu'aucune particule
+// ne s'est déplacée de plus de la marge depuis la construction, le critère reste valide : on garde la topologie de
+// l'octree et les listes, seuls les moments des nœuds sont recalculés avec les positions courantes.
+// L'octree et les listes sont reconstruits au-delà de la marge ou après maxReuse pas.
+class InteractionCache {
+public:
+    // maxReuse : nombre de pas maximal sur les mêmes listes (0 : reconstruction à chaque pas)
+    // margin : marge relative à la taille du cube racine
+    InteractionCache(int maxReuse = 8, float margin = 0.005f, int groupSize = 32, int leafCapacity = 1);
+
+    // Reconstruit ou rafraîchit l'octree puis calcule l'accélération de toutes les particules
+    void build(const std::vector<Particle> &particles);
+    // Renvoie l'accélération calculée lors du dernier build pour cette particule
+    Vector3D computeAcceleration(const Particle &p) const;
+    // Libère l'octree et les listes (force la prochaine reconstruction)
+    void clear();
+    // Nombre de reconstructions complètes et de pas servis par les listes en cache
+    long rebuildCount() const;
+    long reuseCount() const;
+    // Affichage 3D de l'octree sous-jacent
+    void drawGL() const;
+
+private:
+    struct Group {
+        uint32_t begin, count;  // Particules du groupe dans les colonnes triées de l'octree
+        float lo[3], hi[3];     // Boîte englobante au moment de la construction
+        std::vector<uint32_t> list; // Nœuds aplatis acceptés (monopôles ou feuilles sommées directement)
+    };
+
+    int maxReuse;
+    float margin;
+    int groupSize;
+    int leafCapacity;
+    Octree tree;
+
+    std::vector<Group> groups;
+    std::vector<float> x0, y0, z0; // Positions à la construction (indice d'origine)
+    float marginAbs;
+    int age;
+    long rebuilds, reuses;
+    const Particle *base;
+    std::vector<Vector3D> accelerations;
+
+    // Vrai si les listes peuvent encore servir pour ces positions
+    bool reusable(const std::vector<Particle> &particles) const;
+    // Reconstruit l'octree, les groupes et leurs listes
+    void rebuild(const std::vector<Particle> &particles);
+    // Découpe le sous-arbre en groupes ; flatIndex suit l'ordre préfixe du tableau aplati
+    void collectGroups(const Octree *node, uint32_t &flatIndex);
+    // Parcours du tableau aplati avec le critère élargi pour un groupe
+    void buildList(Group &group) const;
+    // Somme des monopôles de la liste pour chaque particule du groupe
+    void evaluate();
+};
+
+#endif // INTERACTIONCACHE_H
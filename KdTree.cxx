@@ -0,0 +1,252 @@
+#include "KdTree.hpp"
+#include "Gravity.hpp"
+
+// Pour OpenGL sur macOS ou autres
+#ifdef DISPLAY_VERSION
+
+#ifdef __APPLE__
+#include <OpenGL/glu.h>
+#else
+#include <GL/glu.h>
+#endif
+
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Nombre de classes testées par l'heuristique de surface
+static const int SAH_BINS = 16;
+
+static float coord(const Particle *p, int axis) {
+    return axis == 0 ? p->x() : (axis == 1 ? p->y() : p->z());
+}
+
+KdTree::KdTree(int leafCapacity, SplitRule rule)
+    : leafCapacity(std::max(1, leafCapacity)), rule(rule) {}
+
+void KdTree::clear() {
+    nodes.clear();
+    items.clear();
+}
+
+std::size_t KdTree::nodeCount() const { return nodes.size(); }
+
+// Construit l'arbre à partir de l'ensemble des particules
+void KdTree::build(const std::vector<Particle> &particles) {
+    clear();
+    if (particles.empty())
+        return;
+    items.reserve(particles.size());
+    for (const auto &p : particles)
+        items.push_back(&p);
+    // Un arbre équilibré a au plus 2N/capacité nœuds
+    nodes.reserve(2 * particles.size() / leafCapacity + 1);
+    buildNode(0, static_cast<int>(items.size()));
+}
+
+// Construit récursivement le nœud couvrant items[begin, end) et renvoie son indice
+int KdTree::buildNode(int begin, int end) {
+    Node node;
+    node.minX = node.minY = node.minZ = std::numeric_limits<float>::max();
+    node.maxX = node.maxY = node.maxZ = std::numeric_limits<float>::lowest();
+    node.totalMass = 0.f;
+    node.centerOfMass = Vector3D(0.f, 0.f, 0.f);
+    node.left = node.right = -1;
+    node.begin = begin;
+    node.count = end - begin;
+
+    // Boîte serrée et moments de masse
+    for (int i = begin; i < end; i++) {
+        const Particle *p = items[i];
+        node.minX = std::min(node.minX, p->x()); node.maxX = std::max(node.maxX, p->x());
+        node.minY = std::min(node.minY, p->y()); node.maxY = std::max(node.maxY, p->y());
+        node.minZ = std::min(node.minZ, p->z()); node.maxZ = std::max(node.maxZ, p->z());
+        node.totalMass += p->getMass();
+        node.centerOfMass += p->getPosition() * p->getMass();
+    }
+    if (node.totalMass > 0.f)
+        node.centerOfMass /= node.totalMass;
+    node.size = std::max(node.maxX - node.minX, std::max(node.maxY - node.minY, node.maxZ - node.minZ));
+
+    int index = static_cast<int>(nodes.size());
+    nodes.push_back(node);
+    if (node.count <= leafCapacity || node.size == 0.f)
+        return index;
+
+    int mid = split(node, begin, end);
+    int left = buildNode(begin, mid);
+    int right = buildNode(mid, end);
+    // nodes peut avoir été réalloué pendant la récursion
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+}
+
+// Choisit le plan de coupe selon la règle et partitionne items[begin, end), renvoie l'indice du milieu
+int KdTree::split(const Node &node, int begin, int end) {
+    float ex = node.maxX - node.minX, ey = node.maxY - node.minY, ez = node.maxZ - node.minZ;
+    int axis = (ex >= ey && ex >= ez) ? 0 : (ey >= ez ? 1 : 2);
+
+    if (rule == SURFACE_AREA) {
+        int mid = splitSurfaceArea(node, axis, begin, end);
+        if (mid > begin && mid < end)
+            return mid;
+        // Coupe dégénérée : on retombe sur la médiane
+    }
+
+    int mid = begin + (end - begin) / 2;
+    std::nth_element(items.begin() + begin, items.begin() + mid, items.begin() + end,
+        [axis](const Particle *a, const Particle *b) { return coord(a, axis) < coord(b, axis); });
+    return mid;
+}
+
+// Heuristique de surface par classes : minimise aire(gauche) * n(gauche) + aire(droite) * n(droite)
+int KdTree::splitSurfaceArea(const Node &node, int axis, int begin, int end) {
+    struct Bin {
+        float lo[3], hi[3];
+        int count;
+    };
+    Bin bins[SAH_BINS];
+    for (int b = 0; b < SAH_BINS; b++) {
+        bins[b].count = 0;
+        for (int k = 0; k < 3; k++) {
+            bins[b].lo[k] = std::numeric_limits<float>::max();
+            bins[b].hi[k] = std::numeric_limits<float>::lowest();
+        }
+    }
+    float lo = axis == 0 ? node.minX : (axis == 1 ? node.minY : node.minZ);
+    float hi = axis == 0 ? node.maxX : (axis == 1 ? node.maxY : node.maxZ);
+    float scale = SAH_BINS / (hi - lo);
+
+    for (int i = begin; i < end; i++) {
+        const Particle *p = items[i];
+        int b = std::min(SAH_BINS - 1, static_cast<int>((coord(p, axis) - lo) * scale));
+        Bin &bin = bins[b];
+        bin.count++;
+        for (int k = 0; k < 3; k++) {
+            bin.lo[k] = std::min(bin.lo[k], coord(p, k));
+            bin.hi[k] = std::max(bin.hi[k], coord(p, k));
+        }
+    }
+
+    auto area = [](const float *l, const float *h) {
+        float dx = h[0] - l[0], dy = h[1] - l[1], dz = h[2] - l[2];
+        return dx * dy + dy * dz + dz * dx;
+    };
+
+    // Balayage droite -> gauche pour les coûts suffixes
+    float rightCost[SAH_BINS];
+    float rl[3], rh[3];
+    int rightCount = 0;
+    for (int k = 0; k < 3; k++) { rl[k] = std::numeric_limits<float>::max(); rh[k] = std::numeric_limits<float>::lowest(); }
+    for (int b = SAH_BINS - 1; b > 0; b--) {
+        rightCount += bins[b].count;
+        for (int k = 0; k < 3; k++) { rl[k] = std::min(rl[k], bins[b].lo[k]); rh[k] = std::max(rh[k], bins[b].hi[k]); }
+        rightCost[b] = rightCount > 0 ? area(rl, rh) * rightCount : 0.f;
+    }
+
+    // Balayage gauche -> droite et choix du meilleur plan
+    float ll[3], lh[3];
+    int leftCount = 0, bestBin = -1;
+    float bestCost = std::numeric_limits<float>::max();
+    for (int k = 0; k < 3; k++) { ll[k] = std::numeric_limits<float>::max(); lh[k] = std::numeric_limits<float>::lowest(); }
+    for (int b = 0; b < SAH_BINS - 1; b++) {
+        leftCount += bins[b].count;
+        for (int k = 0; k < 3; k++) { ll[k] = std::min(ll[k], bins[b].lo[k]); lh[k] = std::max(lh[k], bins[b].hi[k]); }
+        if (leftCount == 0 || leftCount == end - begin)
+            continue;
+        float cost = area(ll, lh) * leftCount + rightCost[b + 1];
+        if (cost < bestCost) {
+            bestCost = cost;
+            bestBin = b;
+        }
+    }
+    if (bestBin < 0)
+        return begin;
+
+    auto it = std::partition(items.begin() + begin, items.begin() + end,
+        [axis, lo, scale, bestBin](const Particle *p) {
+            return std::min(SAH_BINS - 1, static_cast<int>((coord(p, axis) - lo) * scale)) <= bestBin;
+        });
+    return static_cast<int>(it - items.begin());
+}
+
+// Calcule l'accélération sur une particule avec l'approximation Barnes-Hut
+Vector3D KdTree::computeAcceleration(const Particle &p) const {
+    Vector3D acc(0.f, 0.f, 0.f);
+    if (nodes.empty())
+        return acc;
+    Vector3D pPos = p.getPosition();
+    // Pile explicite : l'heuristique de surface peut donner un arbre plus profond que log2(N)
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+
+    while (!stack.empty()) {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.totalMass == 0.f)
+            continue;
+
+        if (node.left >= 0) { // Nœud interne
+            float dx = node.centerOfMass.x - pPos.x;
+            float dy = node.centerOfMass.y - pPos.y;
+            float dz = node.centerOfMass.z - pPos.z;
+            float dist_sq_eps = dx * dx + dy * dy + dz * dz + epsilon_sq;
+            if ((node.size * node.size) < (theta_sq * dist_sq_eps)) {
+                float invDistCube = G * node.totalMass / (dist_sq_eps * std::sqrt(dist_sq_eps));
+                acc.x += dx * invDistCube;
+                acc.y += dy * invDistCube;
+                acc.z += dz * invDistCube;
+            } else {
+                stack.push_back(node.right);
+                stack.push_back(node.left);
+            }
+        } else { // Nœud feuille : somme directe sur ses particules
+            for (int i = node.begin; i < node.begin + node.count; i++) {
+                const Particle *q = items[i];
+                if (q == &p)
+                    continue;
+                float dx = q->x() - pPos.x;
+                float dy = q->y() - pPos.y;
+                float dz = q->z() - pPos.z;
+                float dist_sq_eps = dx * dx + dy * dy + dz * dz + epsilon_sq;
+                float invDistCube = G * q->getMass() / (dist_sq_eps * std::sqrt(dist_sq_eps));
+                acc.x += dx * invDistCube;
+                acc.y += dy * invDistCube;
+                acc.z += dz * invDistCube;
+            }
+        }
+    }
+    return acc;
+}
+
+// Affichage 3D des boîtes englobantes via OpenGL
+void KdTree::drawGL() const {
+    #ifdef DISPLAY_VERSION
+    glColor3f(0.f, 0.5f, 0.f);
+    glBegin(GL_LINES);
+    for (const Node &n : nodes) {
+        float x0 = n.minX, y0 = n.minY, z0 = n.minZ;
+        float x1 = n.maxX, y1 = n.maxY, z1 = n.maxZ;
+        // Face inférieure
+        glVertex3f(x0, y0, z0); glVertex3f(x1, y0, z0);
+        glVertex3f(x1, y0, z0); glVertex3f(x1, y1, z0);
+        glVertex3f(x1, y1, z0); glVertex3f(x0, y1, z0);
+        glVertex3f(x0, y1, z0); glVertex3f(x0, y0, z0);
+        // Face supérieure
+        glVertex3f(x0, y0, z1); glVertex3f(x1, y0, z1);
+        glVertex3f(x1, y0, z1); glVertex3f(x1, y1, z1);
+        glVertex3f(x1, y1, z1); glVertex3f(x0, y1, z1);
+        glVertex3f(x0, y1, z1); glVertex3f(x0, y0, z1);
+        // Arêtes verticales
+        glVertex3f(x0, y0, z0); glVertex3f(x0, y0, z1);
+        glVertex3f(x1, y0, z0); glVertex3f(x1, y0, z1);
+        glVertex3f(x1, y1, z0); glVertex3f(x1, y1, z1);
+        glVertex3f(x0, y1, z0); glVertex3f(x0, y1, z1);
+    }
+    glEnd();
+    #endif // DISPLAY_VERSION
+}
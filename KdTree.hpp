@@ -0,0 +1,51 @@
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include <vector>
+
+#include "Particle.hpp"
+
+// Arbre kd équilibré pour Barnes-Hut en 3D
+// Contrairement à l'octree (cubes égaux), chaque nœud est coupé en deux selon son axe le plus long
+// (médiane ou heuristique de surface) et garde une boîte englobante serrée sur ses particules :
+// pas d'enfants vides pour les disques minces et les ceintures.
+class KdTree {
+public:
+    enum SplitRule { MEDIAN, SURFACE_AREA };
+
+    KdTree(int leafCapacity = 8, SplitRule rule = MEDIAN);
+
+    // Construit l'arbre à partir de l'ensemble des particules
+    void build(const std::vector<Particle> &particles);
+    // Calcule l'accélération sur une particule avec l'approximation Barnes-Hut
+    Vector3D computeAcceleration(const Particle &p) const;
+    // Libère les nœuds de l'arbre
+    void clear();
+    // Affichage 3D des boîtes englobantes via OpenGL
+    void drawGL() const;
+    // Nombre de nœuds de l'arbre construit
+    std::size_t nodeCount() const;
+
+private:
+    struct Node {
+        float minX, minY, minZ, maxX, maxY, maxZ; // Boîte englobante serrée
+        float size;            // Plus grande extension de la boîte
+        float totalMass;       // Masse totale du nœud
+        Vector3D centerOfMass; // Centre de masse du nœud
+        int left, right;       // Indices des enfants (-1 pour une feuille)
+        int begin, count;      // Intervalle des particules dans items
+    };
+
+    int leafCapacity;
+    SplitRule rule;
+    std::vector<Node> nodes;
+    std::vector<const Particle*> items; // Particules réordonnées par nœud
+
+    // Construit récursivement le nœud couvrant items[begin, end) et renvoie son indice
+    int buildNode(int begin, int end);
+    // Choisit le plan de coupe selon la règle et partitionne items[begin, end), renvoie l'indice du milieu
+    int split(const Node &node, int begin, int end);
+    int splitSurfaceArea(const Node &node, int axis, int begin, int end);
+};
+
+#endif // KDTREE_H
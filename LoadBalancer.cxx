@@ -0,0 +1,68 @@
+#include "LoadBalancer.hpp"
+
+#include <algorithm>
+
+LoadBalancer::LoadBalancer() : bounds(1, 0) {}
+
+// Découpe l'ordre spatial en nbChunks intervalles de même coût estimé
+void LoadBalancer::partition(const std::vector<uint32_t> &spatialOrder, std::size_t nbParticles, int nbChunks) {
+    nbChunks = std::max(1, nbChunks);
+    if (costs.size() != nbParticles)
+        costs.assign(nbParticles, 1u);
+
+    // Ordre spatial complété par les particules hors de l'arbre
+    order.assign(spatialOrder.begin(), spatialOrder.end());
+    if (order.size() != nbParticles) {
+        std::vector<bool> seen(nbParticles, false);
+        for (uint32_t i : order)
+            seen[i] = true;
+        for (uint32_t i = 0; i < nbParticles; i++) {
+            if (!seen[i])
+                order.push_back(i);
+        }
+    }
+
+    double total = 0.;
+    for (uint32_t i : order)
+        total += costs[i];
+
+    // Coupe dès que le coût cumulé atteint la part suivante
+    bounds.assign(1, 0);
+    chunkCosts.assign(nbChunks, 0.);
+    double prefix = 0.;
+    int chunk = 0;
+    for (std::size_t k = 0; k < order.size(); k++) {
+        while (chunk < nbChunks - 1 && prefix >= total * (chunk + 1) / nbChunks) {
+            bounds.push_back(k);
+            chunk++;
+        }
+        prefix += costs[order[k]];
+        chunkCosts[chunk] += costs[order[k]];
+    }
+    while (static_cast<int>(bounds.size()) < nbChunks + 1)
+        bounds.push_back(order.size());
+    times.assign(nbChunks, 0.);
+}
+
+int LoadBalancer::chunkCount() const { return static_cast<int>(bounds.size()) - 1; }
+std::size_t LoadBalancer::chunkBegin(int chunk) const { return bounds[chunk]; }
+std::size_t LoadBalancer::chunkEnd(int chunk) const { return bounds[chunk + 1]; }
+uint32_t LoadBalancer::particleAt(std::size_t k) const { return order[k]; }
+
+void LoadBalancer::setCost(uint32_t particle, uint32_t cost) { costs[particle] = std::max(1u, cost); }
+void LoadBalancer::setChunkTime(int chunk, double seconds) { times[chunk] = seconds; }
+
+// Rapport max / moyenne d'une série (1 si vide ou nulle)
+static double maxOverMean(const std::vector<double> &values) {
+    double sum = 0., worst = 0.;
+    for (double v : values) {
+        sum += v;
+        worst = std::max(worst, v);
+    }
+    if (values.empty() || sum <= 0.)
+        return 1.;
+    return worst * values.size() / sum;
+}
+
+double LoadBalancer::imbalance() const { return maxOverMean(times); }
+double LoadBalancer::predictedImbalance() const { return maxOverMean(chunkCosts); }
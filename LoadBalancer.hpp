@@ -0,0 +1,42 @@
+#ifndef LOADBALANCER_H
+#define LOADBALANCER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Équilibrage de charge par coût (costzones) pour la boucle des forces
+//
+// Le coût de chaque particule (nombre d'interactions évaluées) est relevé pendant un pas ; au pas suivant,
+// l'ordre spatial des feuilles de l'octree est découpé en autant d'intervalles contigus que de threads,
+// chacun de coût cumulé égal. Les particules voisines restent sur le même thread (localité des parcours).
+class LoadBalancer {
+public:
+    LoadBalancer();
+
+    // Découpe l'ordre spatial en nbChunks intervalles de même coût estimé ; les particules absentes
+    // de l'ordre (hors du volume de l'arbre) sont ajoutées à la fin
+    void partition(const std::vector<uint32_t> &spatialOrder, std::size_t nbParticles, int nbChunks);
+    int chunkCount() const;
+    std::size_t chunkBegin(int chunk) const;
+    std::size_t chunkEnd(int chunk) const;
+    // Particule à la position k de l'ordre courant
+    uint32_t particleAt(std::size_t k) const;
+
+    // Relevés du pas en cours (un thread par intervalle : pas de synchronisation)
+    void setCost(uint32_t particle, uint32_t cost);
+    void setChunkTime(int chunk, double seconds);
+
+    // Déséquilibre mesuré du dernier pas : temps de l'intervalle le plus lent / temps moyen (1 = parfait)
+    double imbalance() const;
+    // Déséquilibre prévu par les coûts du pas précédent pour le découpage courant
+    double predictedImbalance() const;
+
+private:
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> costs; // Coût par particule (indice d'origine), 1 tant qu'inconnu
+    std::vector<std::size_t> bounds;
+    std::vector<double> chunkCosts, times;
+};
+
+#endif // LOADBALANCER_H
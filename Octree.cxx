@@ -1,4 +1,6 @@
 #include "Octree.hpp"
+#include "Gravity.hpp"
+#include "TaskPool.hpp"
 
 // Pour OpenGL sur macOS ou autres
 #ifdef DISPLAY_VERSION
@@ -11,22 +13,44 @@
 
 #endif
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
+#include <queue>
+#include <functional>
 
-// Définition de la variable statique
-std::vector<const Octree*> Octree::instances;
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
 
-const float G = 6.67430e-11f; // Constante gravitationnelle
-const float theta = 0.5f;     // Seuil d'approximation Barnes-Hut
-const float epsilon = 0.001f; // Facteur d'adoucissement
+// Accès aux positions pour Octree::buildNode
+namespace {
+    // Positions des particules de la simulation
+    struct ParticlePositions {
+        const std::vector<Particle> &particles;
+        explicit ParticlePositions(const std::vector<Particle> &particles) : particles(particles) {}
+        float x(uint32_t i) const { return particles[i].x(); }
+        float y(uint32_t i) const { return particles[i].y(); }
+        float z(uint32_t i) const { return particles[i].z(); }
+    };
 
-const float epsilon_sq = epsilon * epsilon;
-const float theta_sq = theta * theta;
+    // Colonnes de positions (état publié)
+    struct ColumnPositions {
+        const float *px, *py, *pz;
+        ColumnPositions(const float *px, const float *py, const float *pz) : px(px), py(py), pz(pz) {}
+        float x(uint32_t i) const { return px[i]; }
+        float y(uint32_t i) const { return py[i]; }
+        float z(uint32_t i) const { return pz[i]; }
+    };
+}
+
+// Définition de la variable statique
+std::vector<const Octree*> Octree::instances;
+std::mutex Octree::instancesMutex;
 
 Octree::Octree(float x, float y, float z, float width, float height, float depth, int capacity)
     : x(x), y(y), z(z), width(width), height(height), depth(depth), capacity(capacity),
-        totalMass(0.f), centerOfMass(0.f, 0.f, 0.f) {}
+        begin(0), count(0), leaf(true), totalMass(0.f), centerOfMass(0.f, 0.f, 0.f), wideTraversal(false), openingSq(theta_sq) {}
 
 Octree::~Octree() { clear(); }
 
@@ -54,115 +78,615 @@ bool Octree::contains(const Particle *p) const {
             p->z() >= z && p->z() < z + depth);
 }
 
-// Découpe le volume en 8 sous-volumes (octants)
-void Octree::subdivide() {
+// Crée le sous-volume correspondant à un octant
+Octree* Octree::createChild(int octant) const {
     float hw = width * 0.5f;
     float hh = height * 0.5f;
     float hd = depth * 0.5f;
-    children[0] = new Octree(x, y, z, hw, hh, hd, capacity);
-    children[1] = new Octree(x + hw, y, z, hw, hh, hd, capacity);
-    children[2] = new Octree(x, y + hh, z, hw, hh, hd, capacity);
-    children[3] = new Octree(x + hw, y + hh, z, hw, hh, hd, capacity);
-    children[4] = new Octree(x, y, z + hd, hw, hh, hd, capacity);
-    children[5] = new Octree(x + hw, y, z + hd, hw, hh, hd, capacity);
-    children[6] = new Octree(x, y + hh, z + hd, hw, hh, hd, capacity);
-    children[7] = new Octree(x + hw, y + hh, z + hd, hw, hh, hd, capacity);
-}
-
-// Insertion d'une particule dans l'octree
-void Octree::insert(const Particle* p) {
-    if (!contains(p))
-        return;
+    return new Octree(x + ((octant & 1) ? hw : 0.f), y + ((octant & 2) ? hh : 0.f), z + ((octant & 4) ? hd : 0.f),
+                      hw, hh, hd, capacity);
+}
+
+// Reconstruit l'octree à partir de l'ensemble des particules puis l'aplatit
+void Octree::build(const std::vector<Particle> &particles) {
+    buildTopology(particles);
+    computeMoments();
+}
+
+// Subdivision et colonnes triées seulement (les moments sont calculés par computeMoments)
+void Octree::buildTopology(const std::vector<Particle> &particles) {
+    clear();
+    // Les particules hors du volume sont ignorées
+    sortedIndex.reserve(particles.size());
+    for (uint32_t i = 0; i < particles.size(); i++) {
+        if (contains(&particles[i]))
+            sortedIndex.push_back(i);
+    }
+    std::vector<uint32_t> scratch(sortedIndex.size());
+    buildNode(ParticlePositions(particles), sortedIndex, scratch, 0, static_cast<uint32_t>(sortedIndex.size()), 0, true);
+    gatherColumns(particles);
+}
+
+void Octree::build(const float *px, const float *py, const float *pz, const float *mass, std::size_t n) {
+    clear();
+    ColumnPositions positions(px, py, pz);
+    sortedIndex.reserve(n);
+    for (uint32_t i = 0; i < n; i++) {
+        if (px[i] >= x && px[i] < x + width && py[i] >= y && py[i] < y + height && pz[i] >= z && pz[i] < z + depth)
+            sortedIndex.push_back(i);
+    }
+    std::vector<uint32_t> scratch(sortedIndex.size());
+    buildNode(positions, sortedIndex, scratch, 0, static_cast<uint32_t>(sortedIndex.size()), 0, false);
+    std::size_t kept = sortedIndex.size();
+    arenaResize(sortedX, kept); arenaResize(sortedY, kept); arenaResize(sortedZ, kept); arenaResize(sortedMass, kept);
+    for (std::size_t i = 0; i < kept; i++) {
+        sortedX[i] = px[sortedIndex[i]];
+        sortedY[i] = py[sortedIndex[i]];
+        sortedZ[i] = pz[sortedIndex[i]];
+        sortedMass[i] = mass[sortedIndex[i]];
+    }
+}
 
-    // Mise à jour du centre de masse
-    Vector3D pPos = p->getPosition();
-    float pMass = p->getMass();
-    float newTotalMass = totalMass + pMass;
-    centerOfMass = (centerOfMass * totalMass + pPos * pMass) / newTotalMass;
-    totalMass = newTotalMass;
+// Moments seuls, sans disposition de parcours ni pool
+void Octree::computeMassMoments() {
+    if (count > 0)
+        refreshNode(*this, false);
+}
+
+// Met à jour colonnes et moments avec les positions courantes sans reconstruire la topologie
+void Octree::refresh(const std::vector<Particle> &particles) {
+    gatherColumns(particles);
+    computeMoments();
+}
+
+// Colonnes contiguës dans l'ordre spatial pour les boucles des feuilles
+// Remplies par blocs contigus sur le pool, comme la boucle des forces : chaque page est placée (premier
+// contact) sur le nœud NUMA d'un thread qui traite ces particules
+void Octree::gatherColumns(const std::vector<Particle> &particles) {
+    std::size_t n = sortedIndex.size();
+    arenaResize(sortedX, n); arenaResize(sortedY, n); arenaResize(sortedZ, n); arenaResize(sortedMass, n);
+    TaskPool::global().parallelFor(0, n, TASK_GRAIN, [this, &particles](std::size_t i) {
+        const Particle &p = particles[sortedIndex[i]];
+        sortedX[i] = p.x();
+        sortedY[i] = p.y();
+        sortedZ[i] = p.z();
+        sortedMass[i] = p.getMass();
+    });
+}
 
-    if (children[0] == nullptr && particles.size() < static_cast<unsigned>(capacity)) {
-        particles.push_back(p);
+// Passe montante des moments (masse, centre de masse) puis disposition pour le parcours
+void Octree::computeMoments() {
+    if (count > 0)
+        refreshNode(*this, true);
+    if (wideTraversal)
+        buildWide();
+    else
+        flatten();
+}
+
+// Recalcule les moments du sous-arbre depuis les colonnes triées de la racine (topologie inchangée)
+// Moments en double : une particule seule garde exactement sa position (auto-interaction nulle)
+void Octree::refreshNode(const Octree &root, bool parallel) {
+    double mass = 0., mx = 0., my = 0., mz = 0.;
+    if (leaf) {
+        for (uint32_t i = begin; i < begin + count; i++) {
+            double m = root.sortedMass[i];
+            mass += m;
+            mx += root.sortedX[i] * m;
+            my += root.sortedY[i] * m;
+            mz += root.sortedZ[i] * m;
+        }
     } else {
-        if (children[0] == nullptr) {
-            subdivide();
-            // Réinsertion des particules existantes dans les sous-volumes
-            for (auto existing : particles) {
-                int octant = getOctant(existing);
-                if (octant != -1) {
-                    children[octant]->insert(existing);
-                }
+        TaskPool &pool = TaskPool::global();
+        TaskGroup group;
+        for (int j = 0; j < 8; j++) {
+            Octree *child = children[j];
+            if (child == nullptr)
+                continue;
+            if (parallel && child->count >= TASK_GRAIN)
+                pool.spawn(group, [child, &root]() { child->refreshNode(root, true); });
+            else
+                child->refreshNode(root, parallel);
+        }
+        pool.wait(group);
+        for (int j = 0; j < 8; j++) {
+            if (children[j] == nullptr)
+                continue;
+            double childMass = children[j]->totalMass;
+            mass += childMass;
+            mx += children[j]->centerOfMass.x * childMass;
+            my += children[j]->centerOfMass.y * childMass;
+            mz += children[j]->centerOfMass.z * childMass;
+        }
+    }
+    totalMass = static_cast<float>(mass);
+    if (mass > 0.)
+        centerOfMass = Vector3D(static_cast<float>(mx / mass), static_cast<float>(my / mass), static_cast<float>(mz / mass));
+}
+
+// Choisit le parcours : nœuds larges SIMD (true) ou tableau aplati sans pile (false)
+void Octree::setWideTraversal(bool wide) { wideTraversal = wide; }
+
+void Octree::setTheta(float theta) { openingSq = theta * theta; }
+
+// Construit récursivement la topologie du sous-arbre sur order[begin, begin + count) (tri par octant en place)
+template <class Positions>
+void Octree::buildNode(const Positions &positions, std::vector<uint32_t> &order,
+                       std::vector<uint32_t> &scratch, uint32_t first, uint32_t n, int level, bool parallel) {
+    begin = first;
+    count = n;
+    leaf = (n <= static_cast<uint32_t>(capacity) || level >= MAX_DEPTH);
+
+    if (!leaf) {
+        // Tri par octant (comptage puis dispersion dans scratch)
+        uint32_t counts[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        for (uint32_t i = first; i < first + n; i++) {
+            uint32_t p = order[i];
+            counts[getOctant(positions.x(p), positions.y(p), positions.z(p))]++;
+        }
+        uint32_t offsets[8];
+        offsets[0] = first;
+        for (int j = 1; j < 8; j++)
+            offsets[j] = offsets[j - 1] + counts[j - 1];
+        uint32_t cursor[8];
+        std::copy(offsets, offsets + 8, cursor);
+        for (uint32_t i = first; i < first + n; i++) {
+            uint32_t p = order[i];
+            scratch[cursor[getOctant(positions.x(p), positions.y(p), positions.z(p))]++] = p;
+        }
+        std::copy(scratch.begin() + first, scratch.begin() + first + n, order.begin() + first);
+
+        // Seuls les octants non vides sont créés ; les gros sous-arbres sont construits en tâches
+        // (intervalles disjoints de order et scratch)
+        TaskPool &pool = TaskPool::global();
+        TaskGroup group;
+        for (int j = 0; j < 8; j++) {
+            if (counts[j] == 0)
+                continue;
+            Octree *child = createChild(j);
+            children[j] = child;
+            uint32_t childBegin = offsets[j], childCount = counts[j];
+            if (parallel && childCount >= TASK_GRAIN) {
+                pool.spawn(group, [child, &positions, &order, &scratch, childBegin, childCount, level]() {
+                    child->buildNode(positions, order, scratch, childBegin, childCount, level + 1, true);
+                });
+            } else {
+                child->buildNode(positions, order, scratch, childBegin, childCount, level + 1, parallel);
             }
-            particles.clear();
         }
-        int octant = getOctant(p);
-        if (octant != -1) {
-            children[octant]->insert(p);
+        pool.wait(group);
+    }
+}
+
+// Aplatit l'arbre construit en tableau compact en profondeur avec liens de saut
+void Octree::flatten() {
+    flatNodes.clear();
+    if (count == 0)
+        return;
+    flatNodes.reserve(nodeCount());
+    flattenNode(this);
+}
+
+// Écrit le nœud et son sous-arbre dans flatNodes
+void Octree::flattenNode(const Octree *node) {
+    std::size_t index = flatNodes.size();
+    float size = std::max(node->width, std::max(node->height, node->depth));
+    FlatNode flat = {node->centerOfMass.x, node->centerOfMass.y, node->centerOfMass.z, node->totalMass,
+                     node->leaf ? 0.f : size * size, 0, node->begin, node->leaf ? node->count : 0};
+    flatNodes.push_back(flat);
+    for (int j = 0; j < 8; j++) {
+        if (node->children[j] != nullptr)
+            flattenNode(node->children[j]);
+    }
+    flatNodes[index].next = static_cast<uint32_t>(flatNodes.size());
+}
+
+// Construit la disposition en nœuds larges (8 enfants en colonnes)
+void Octree::buildWide() {
+    wideNodes.clear();
+    if (count == 0)
+        return;
+    // Nœud 0 : une seule voie, la racine elle-même
+    const Octree *root = this;
+    buildWideNode(&root, 1);
+}
+
+// Écrit un nœud large pour les voies données (et récursivement leurs enfants), renvoie son indice
+int32_t Octree::buildWideNode(const Octree *const *lanes, int nbLanes) {
+    int32_t index = static_cast<int32_t>(wideNodes.size());
+    WideNode wide;
+    for (int j = 0; j < 8; j++) {
+        wide.comX[j] = wide.comY[j] = wide.comZ[j] = 0.f;
+        wide.mass[j] = 0.f;
+        wide.sizeSq[j] = -1.f;
+        wide.direct[j] = 0u;
+        wide.child[j] = -1;
+        wide.begin[j] = wide.leafCount[j] = 0u;
+    }
+    for (int j = 0; j < nbLanes; j++) {
+        const Octree *node = lanes[j];
+        float size = std::max(node->width, std::max(node->height, node->depth));
+        wide.comX[j] = node->centerOfMass.x;
+        wide.comY[j] = node->centerOfMass.y;
+        wide.comZ[j] = node->centerOfMass.z;
+        wide.mass[j] = node->totalMass;
+        wide.sizeSq[j] = node->leaf ? -1.f : size * size;
+        wide.begin[j] = node->begin;
+        wide.leafCount[j] = node->leaf ? node->count : 0u;
+        // Une feuille à plusieurs particules est sommée directement, pas en monopôle
+        wide.direct[j] = (node->leaf && node->count > 1) ? 0xFFFFFFFFu : 0u;
+    }
+    wideNodes.push_back(wide);
+
+    for (int j = 0; j < nbLanes; j++) {
+        const Octree *node = lanes[j];
+        if (node->leaf)
+            continue;
+        const Octree *children[8];
+        int nbChildren = 0;
+        for (int k = 0; k < 8; k++) {
+            if (node->children[k] != nullptr)
+                children[nbChildren++] = node->children[k];
         }
+        int32_t childIndex = buildWideNode(children, nbChildren);
+        // wideNodes peut avoir été réalloué pendant la récursion
+        wideNodes[index].child[j] = childIndex;
     }
+    return index;
 }
 
-// Détermine dans quel octant se trouve une particule
-int Octree::getOctant(const Particle* p) const {
+// Détermine dans quel octant se trouve un point
+int Octree::getOctant(float px, float py, float pz) const {
     float midX = x + width * 0.5f;
     float midY = y + height * 0.5f;
     float midZ = z + depth * 0.5f;
     int oct = 0;
-    if (p->x() >= midX) oct |= 1;
-    if (p->y() >= midY) oct |= 2;
-    if (p->z() >= midZ) oct |= 4;
+    if (px >= midX) oct |= 1;
+    if (py >= midY) oct |= 2;
+    if (pz >= midZ) oct |= 4;
     return oct;
 }
 
 // Calcule l'accélération sur une particule avec l'approximation Barnes-Hut
+// Parcours linéaire du tableau aplati : on descend (i + 1) si le nœud doit être ouvert,
+// sinon on accepte sa contribution et on saute son sous-arbre (next). Aucune pile.
+// Une feuille est toujours acceptée, même avec theta = 0 : monopôle exact si elle ne contient qu'une particule,
+// sinon somme directe sur son intervalle contigu des colonnes triées.
+// La particule elle-même contribue 0 (dx = dy = dz = 0), sans test d'identité.
 Vector3D Octree::computeAcceleration(const Particle &p) const {
-    Vector3D acc(0.f, 0.f, 0.f);
-    Vector3D pPos = p.getPosition();
-    std::vector<const Octree*> stack;
-    stack.reserve(64);
-    stack.push_back(this);
-
-    for (size_t i = 0; i < stack.size(); i++) {
-        const Octree* node = stack[i];
-        if (node->totalMass == 0.f)
-            continue;
+    uint32_t interactions;
+    return computeAcceleration(p, interactions);
+}
+
+// Même calcul en comptant les interactions évaluées (monopôles et particules des feuilles directes)
+Vector3D Octree::computeAcceleration(const Particle &p, uint32_t &interactions) const {
+    interactions = 0;
+    if (wideTraversal)
+        return computeAccelerationWide(p, interactions);
+    float accX = 0.f, accY = 0.f, accZ = 0.f;
+    float px = p.x(), py = p.y(), pz = p.z();
+    const FlatNode *nodes = flatNodes.data();
+    uint32_t nbNodes = static_cast<uint32_t>(flatNodes.size());
+
+    uint32_t i = 0;
+    while (i < nbNodes) {
+        const FlatNode &node = nodes[i];
+        float dx = node.comX - px;
+        float dy = node.comY - py;
+        float dz = node.comZ - pz;
+        float dist_sq_eps = dx * dx + dy * dy + dz * dz + epsilon_sq;
+
+        if (node.leafCount > 0 || node.sizeSq < openingSq * dist_sq_eps) {
+            if (node.leafCount > 1) { // Feuille à plusieurs particules : flux contigu
+                directKernel(px, py, pz, &sortedX[node.begin], &sortedY[node.begin], &sortedZ[node.begin],
+                             &sortedMass[node.begin], static_cast<int>(node.leafCount), accX, accY, accZ);
+                interactions += node.leafCount;
+            } else {
+                float invDistCube = G * node.mass / (dist_sq_eps * std::sqrt(dist_sq_eps));
+                accX += dx * invDistCube;
+                accY += dy * invDistCube;
+                accZ += dz * invDistCube;
+                interactions++;
+            }
+            i = node.next;
+        } else {
+            i++;
+        }
+    }
+    return Vector3D(accX, accY, accZ);
+}
 
-        float dx = node->centerOfMass.x - pPos.x;
-        float dy = node->centerOfMass.y - pPos.y;
-        float dz = node->centerOfMass.z - pPos.z;
-        float dist_sq = dx * dx + dy * dy + dz * dz;
-        float dist_sq_eps = dist_sq + epsilon_sq;
-
-        if (node->children[0] != nullptr) { // Nœud interne
-            float size = std::max(node->width, std::max(node->height, node->depth));
-            if ((size * size) < (theta_sq * dist_sq_eps)) {
-                float sqrt_dist = std::sqrt(dist_sq_eps);
-                float invDistCube = G * node->totalMass / (dist_sq_eps * sqrt_dist);
-                acc.x += dx * invDistCube;
-                acc.y += dy * invDistCube;
-                acc.z += dz * invDistCube;
+// Parcours Barnes-Hut sur les nœuds larges : pour chaque nœud dépilé, le critère d'ouverture et
+// les monopôles acceptés des 8 enfants sont évalués en un seul groupe d'instructions AVX.
+// Seuls les enfants à ouvrir sont empilés ; les feuilles à plusieurs particules passent par le noyau direct.
+Vector3D Octree::computeAccelerationWide(const Particle &p, uint32_t &interactions) const {
+    float accX = 0.f, accY = 0.f, accZ = 0.f;
+    if (wideNodes.empty())
+        return Vector3D(accX, accY, accZ);
+    float px = p.x(), py = p.y(), pz = p.z();
+    // Chaque niveau empile au plus 8 nœuds larges
+    int32_t stack[8 * (MAX_DEPTH + 2)];
+    int top = 0;
+    stack[top++] = 0;
+
+#ifdef __AVX__
+    const __m256 vpx = _mm256_set1_ps(px), vpy = _mm256_set1_ps(py), vpz = _mm256_set1_ps(pz);
+    const __m256 veps = _mm256_set1_ps(epsilon_sq), vtheta = _mm256_set1_ps(openingSq), vG = _mm256_set1_ps(G);
+    __m256 vaccX = _mm256_setzero_ps(), vaccY = _mm256_setzero_ps(), vaccZ = _mm256_setzero_ps();
+#endif
+
+    while (top > 0) {
+        const WideNode &w = wideNodes[stack[--top]];
+        interactions += 8;
+#ifdef __AVX__
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(w.comX), vpx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(w.comY), vpy);
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(w.comZ), vpz);
+        __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                  _mm256_add_ps(_mm256_mul_ps(dz, dz), veps));
+        __m256 accept = _mm256_cmp_ps(_mm256_loadu_ps(w.sizeSq), _mm256_mul_ps(vtheta, d2), _CMP_LT_OQ);
+        __m256 direct = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(w.direct)));
+        __m256 monopole = _mm256_andnot_ps(direct, accept);
+        __m256 f = _mm256_div_ps(_mm256_mul_ps(vG, _mm256_loadu_ps(w.mass)), _mm256_mul_ps(d2, _mm256_sqrt_ps(d2)));
+        f = _mm256_and_ps(f, monopole);
+        vaccX = _mm256_add_ps(vaccX, _mm256_mul_ps(dx, f));
+        vaccY = _mm256_add_ps(vaccY, _mm256_mul_ps(dy, f));
+        vaccZ = _mm256_add_ps(vaccZ, _mm256_mul_ps(dz, f));
+        int openBits = ~_mm256_movemask_ps(accept) & 0xFF;
+        int directBits = _mm256_movemask_ps(direct);
+#else
+        int openBits = 0, directBits = 0;
+        for (int j = 0; j < 8; j++) {
+            float dx = w.comX[j] - px, dy = w.comY[j] - py, dz = w.comZ[j] - pz;
+            float d2 = dx * dx + dy * dy + dz * dz + epsilon_sq;
+            if (!(w.sizeSq[j] < openingSq * d2)) {
+                openBits |= 1 << j;
+            } else if (w.direct[j]) {
+                directBits |= 1 << j;
             } else {
-                for (int j = 0; j < 8; j++) {
-                    if (node->children[j] != nullptr)
-                        stack.push_back(node->children[j]);
+                float f = G * w.mass[j] / (d2 * std::sqrt(d2));
+                accX += dx * f;
+                accY += dy * f;
+                accZ += dz * f;
+            }
+        }
+#endif
+        // Feuilles à plusieurs particules (toujours acceptées car sizeSq < 0)
+        while (directBits) {
+            int j = __builtin_ctz(directBits);
+            directBits &= directBits - 1;
+            directKernel(px, py, pz, &sortedX[w.begin[j]], &sortedY[w.begin[j]], &sortedZ[w.begin[j]],
+                         &sortedMass[w.begin[j]], static_cast<int>(w.leafCount[j]), accX, accY, accZ);
+            interactions += w.leafCount[j];
+        }
+        // Enfants à ouvrir
+        while (openBits) {
+            int j = __builtin_ctz(openBits);
+            openBits &= openBits - 1;
+            stack[top++] = w.child[j];
+        }
+    }
+
+#ifdef __AVX__
+    float lanes[8];
+    _mm256_storeu_ps(lanes, vaccX);
+    for (int j = 0; j < 8; j++) accX += lanes[j];
+    _mm256_storeu_ps(lanes, vaccY);
+    for (int j = 0; j < 8; j++) accY += lanes[j];
+    _mm256_storeu_ps(lanes, vaccZ);
+    for (int j = 0; j < 8; j++) accZ += lanes[j];
+#endif
+    return Vector3D(accX, accY, accZ);
+}
+
+// Indices des particules de l'octree dans l'ordre spatial des feuilles
+const std::vector<uint32_t>& Octree::spatialOrder() const { return sortedIndex; }
+
+// Distance au carré d'un point au volume du nœud (0 à l'intérieur)
+float Octree::distanceSq(const Vector3D &point) const {
+    float dx = std::max(std::max(x - point.x, point.x - (x + width)), 0.f);
+    float dy = std::max(std::max(y - point.y, point.y - (y + height)), 0.f);
+    float dz = std::max(std::max(z - point.z, point.z - (z + depth)), 0.f);
+    return dx * dx + dy * dy + dz * dz;
+}
+
+void Octree::queryBox(const Vector3D &min, const Vector3D &max, std::vector<uint32_t> &found) const {
+    if (count > 0)
+        collectBox(*this, min, max, found);
+}
+
+void Octree::collectBox(const Octree &root, const Vector3D &min, const Vector3D &max, std::vector<uint32_t> &found) const {
+    if (x > max.x || x + width < min.x || y > max.y || y + height < min.y || z > max.z || z + depth < min.z)
+        return;
+    // Volume entièrement dans la boîte : tout le sous-arbre sans tester les particules
+    if (x >= min.x && x + width <= max.x && y >= min.y && y + height <= max.y && z >= min.z && z + depth <= max.z) {
+        found.insert(found.end(), root.sortedIndex.begin() + begin, root.sortedIndex.begin() + begin + count);
+        return;
+    }
+    if (leaf) {
+        for (uint32_t i = begin; i < begin + count; i++) {
+            if (root.sortedX[i] >= min.x && root.sortedX[i] <= max.x &&
+                root.sortedY[i] >= min.y && root.sortedY[i] <= max.y &&
+                root.sortedZ[i] >= min.z && root.sortedZ[i] <= max.z)
+                found.push_back(root.sortedIndex[i]);
+        }
+        return;
+    }
+    for (int j = 0; j < 8; j++) {
+        if (children[j] != nullptr)
+            children[j]->collectBox(root, min, max, found);
+    }
+}
+
+void Octree::queryRadius(const Vector3D &center, float radius, std::vector<uint32_t> &found) const {
+    if (count > 0 && radius >= 0.f)
+        collectRadius(*this, center, radius * radius, found);
+}
+
+void Octree::collectRadius(const Octree &root, const Vector3D &center, float radiusSq, std::vector<uint32_t> &found) const {
+    if (distanceSq(center) > radiusSq)
+        return;
+    // Coin le plus éloigné dans la sphère : tout le sous-arbre
+    float fx = std::max(center.x - x, x + width - center.x);
+    float fy = std::max(center.y - y, y + height - center.y);
+    float fz = std::max(center.z - z, z + depth - center.z);
+    if (fx * fx + fy * fy + fz * fz <= radiusSq) {
+        found.insert(found.end(), root.sortedIndex.begin() + begin, root.sortedIndex.begin() + begin + count);
+        return;
+    }
+    if (leaf) {
+        for (uint32_t i = begin; i < begin + count; i++) {
+            float dx = root.sortedX[i] - center.x, dy = root.sortedY[i] - center.y, dz = root.sortedZ[i] - center.z;
+            if (dx * dx + dy * dy + dz * dz <= radiusSq)
+                found.push_back(root.sortedIndex[i]);
+        }
+        return;
+    }
+    for (int j = 0; j < 8; j++) {
+        if (children[j] != nullptr)
+            children[j]->collectRadius(root, center, radiusSq, found);
+    }
+}
+
+void Octree::levelOfDetail(int levels, uint32_t sparse, std::vector<LodCell> &cells, std::vector<uint32_t> &found) const {
+    if (count > 0)
+        collectDepth(*this, levels, sparse, cells, found);
+}
+
+void Octree::collectDepth(const Octree &root, int levels, uint32_t sparse, std::vector<LodCell> &cells, std::vector<uint32_t> &found) const {
+    if (count <= sparse) {
+        found.insert(found.end(), root.sortedIndex.begin() + begin, root.sortedIndex.begin() + begin + count);
+        return;
+    }
+    if (levels == 0 || leaf) {
+        LodCell cell = {centerOfMass, totalMass, count, Vector3D(x, y, z), Vector3D(width, height, depth)};
+        cells.push_back(cell);
+        return;
+    }
+    for (int j = 0; j < 8; j++) {
+        if (children[j] != nullptr)
+            children[j]->collectDepth(root, levels - 1, sparse, cells, found);
+    }
+}
+
+// Raffinement glouton : le nœud agrégé le plus peuplé est remplacé par ses enfants (ou ses particules pour une feuille)
+// tant que le nombre d'éléments reste dans le budget
+void Octree::levelOfDetailBudget(std::size_t budget, uint32_t sparse, std::vector<LodCell> &cells, std::vector<uint32_t> &found) const {
+    if (count == 0)
+        return;
+    typedef std::pair<uint32_t, const Octree*> Candidate;
+    std::priority_queue<Candidate> open; // Nœuds agrégés, les plus peuplés d'abord
+    std::vector<const Octree*> kept;     // Nœuds agrégés qui ne peuvent plus être ouverts
+    std::size_t items = 1;
+    if (count <= sparse && count <= budget) {
+        found.insert(found.end(), sortedIndex.begin() + begin, sortedIndex.begin() + begin + count);
+        return;
+    }
+    open.push(Candidate(count, this));
+    while (!open.empty()) {
+        const Octree *node = open.top().second;
+        open.pop();
+        // Éléments qui remplaceraient le nœud
+        std::size_t expanded = 0;
+        if (node->leaf) {
+            expanded = node->count;
+        } else {
+            for (int j = 0; j < 8; j++) {
+                const Octree *child = node->children[j];
+                if (child != nullptr)
+                    expanded += child->count <= sparse ? child->count : 1;
+            }
+        }
+        if (items - 1 + expanded > budget) {
+            kept.push_back(node);
+            continue;
+        }
+        items += expanded - 1;
+        if (node->leaf) {
+            found.insert(found.end(), sortedIndex.begin() + node->begin, sortedIndex.begin() + node->begin + node->count);
+            continue;
+        }
+        for (int j = 0; j < 8; j++) {
+            const Octree *child = node->children[j];
+            if (child == nullptr)
+                continue;
+            if (child->count <= sparse)
+                found.insert(found.end(), sortedIndex.begin() + child->begin, sortedIndex.begin() + child->begin + child->count);
+            else
+                open.push(Candidate(child->count, child));
+        }
+    }
+    for (const Octree *node : kept) {
+        LodCell cell = {node->centerOfMass, node->totalMass, node->count,
+                        Vector3D(node->x, node->y, node->z), Vector3D(node->width, node->height, node->depth)};
+        cells.push_back(cell);
+    }
+}
+
+// Parcours du meilleur d'abord : les nœuds sont ouverts par distance croissante au point,
+// jusqu'à ce que le plus proche restant soit plus loin que le k-ième voisin trouvé
+std::vector<std::pair<float, uint32_t> > Octree::nearest(const Vector3D &center, std::size_t k) const {
+    typedef std::pair<float, const Octree*> Candidate;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate> > nodes;
+    std::priority_queue<std::pair<float, uint32_t> > best; // Tas max des k plus proches
+    if (count > 0 && k > 0)
+        nodes.push(Candidate(distanceSq(center), this));
+    while (!nodes.empty()) {
+        Candidate candidate = nodes.top();
+        nodes.pop();
+        if (best.size() == k && candidate.first > best.top().first)
+            break;
+        const Octree *node = candidate.second;
+        if (node->leaf) {
+            for (uint32_t i = node->begin; i < node->begin + node->count; i++) {
+                float dx = sortedX[i] - center.x, dy = sortedY[i] - center.y, dz = sortedZ[i] - center.z;
+                float d = dx * dx + dy * dy + dz * dz;
+                if (best.size() < k) {
+                    best.push(std::make_pair(d, sortedIndex[i]));
+                } else if (d < best.top().first) {
+                    best.pop();
+                    best.push(std::make_pair(d, sortedIndex[i]));
                 }
             }
-        } else { // Nœud feuille
-            if (node->particles.size() == 1 && node->particles[0] == &p)
+            continue;
+        }
+        for (int j = 0; j < 8; j++) {
+            const Octree *child = node->children[j];
+            if (child == nullptr)
                 continue;
-            float sqrt_dist = std::sqrt(dist_sq_eps);
-            float invDistCube = G * node->totalMass / (dist_sq_eps * sqrt_dist);
-            acc.x += dx * invDistCube;
-            acc.y += dy * invDistCube;
-            acc.z += dz * invDistCube;
+            float d = child->distanceSq(center);
+            if (best.size() < k || d <= best.top().first)
+                nodes.push(Candidate(d, child));
         }
     }
-    return acc;
+    std::vector<std::pair<float, uint32_t> > result(best.size());
+    for (std::size_t r = result.size(); r > 0; r--) {
+        result[r - 1] = best.top();
+        best.pop();
+    }
+    return result;
+}
+
+// Tableaux de la racine pour le rapport de placement mémoire
+std::vector<Arena::Region> Octree::arenaRegions() const {
+    std::vector<Arena::Region> regions;
+    regions.push_back({"octree.x", sortedX.data(), sortedX.size() * sizeof(float)});
+    regions.push_back({"octree.y", sortedY.data(), sortedY.size() * sizeof(float)});
+    regions.push_back({"octree.z", sortedZ.data(), sortedZ.size() * sizeof(float)});
+    regions.push_back({"octree.mass", sortedMass.data(), sortedMass.size() * sizeof(float)});
+    if (wideTraversal)
+        regions.push_back({"octree.wide", wideNodes.data(), wideNodes.size() * sizeof(WideNode)});
+    else
+        regions.push_back({"octree.nodes", flatNodes.data(), flatNodes.size() * sizeof(FlatNode)});
+    return regions;
 }
 
 // Libère la mémoire et réinitialise l'octree
 void Octree::clear() {
-    particles.clear();
+    flatNodes.clear();
+    wideNodes.clear();
+    sortedIndex.clear();
+    sortedX.clear(); sortedY.clear(); sortedZ.clear(); sortedMass.clear();
     for (int i = 0; i < 8; i++) {
         if (children[i] != nullptr) {
             children[i]->clear();
@@ -170,12 +694,37 @@ void Octree::clear() {
             children[i] = nullptr;
         }
     }
+    begin = count = 0;
+    leaf = true;
     totalMass = 0.f;
     centerOfMass = Vector3D(0.f, 0.f, 0.f);
 }
 
+// clear() puis rend aussi la capacité des tableaux de la racine
+void Octree::release() {
+    clear();
+    InterleavedVector<FlatNode>().swap(flatNodes);
+    InterleavedVector<WideNode>().swap(wideNodes);
+    std::vector<uint32_t>().swap(sortedIndex);
+    ArenaVector<float>().swap(sortedX);
+    ArenaVector<float>().swap(sortedY);
+    ArenaVector<float>().swap(sortedZ);
+    ArenaVector<float>().swap(sortedMass);
+}
+
+// Nombre de nœuds de l'octree (racine comprise)
+std::size_t Octree::nodeCount() const {
+    std::size_t count = 1;
+    for (int i = 0; i < 8; i++) {
+        if (children[i] != nullptr)
+            count += children[i]->nodeCount();
+    }
+    return count;
+}
+
 // We override the new operator to manage instances of Octree
 void* Octree::operator new(std::size_t size) {
+    std::lock_guard<std::mutex> lock(instancesMutex);
     if (!instances.empty()) {
         const Octree* instance = instances.back();
         instances.pop_back();
@@ -185,11 +734,13 @@ void* Octree::operator new(std::size_t size) {
 }
 
 void Octree::operator delete(void* ptr) {
+    std::lock_guard<std::mutex> lock(instancesMutex);
     instances.push_back(static_cast<const Octree*>(ptr));
 }
 
 // We to a static method to clear all instances for real deallocation
 void Octree::clearInstances() {
+    std::lock_guard<std::mutex> lock(instancesMutex);
     for (const Octree* instance : instances) {
         ::operator delete(const_cast<Octree*>(instance));
     }
@@ -220,11 +771,9 @@ void Octree::drawGL() const {
         glVertex3f(x0, y1, z0); glVertex3f(x0, y1, z1);
     glEnd();
     // Affichage récursif des sous-volumes
-    if (children[0] != nullptr) {
-        for (int i = 0; i < 8; i++) {
-            if (children[i] != nullptr)
-                children[i]->drawGL();
-        }
+    for (int i = 0; i < 8; i++) {
+        if (children[i] != nullptr)
+            children[i]->drawGL();
     }
     #endif // DISPLAY_VERSION
 }
\ No newline at end of file
@@ -2,37 +2,164 @@
 #define OCTREE_H
 
 #include <vector>
+#include <cstdint>
+#include <mutex>
 
 #include "Particle.hpp"
+#include "Arena.hpp"
+
+// Nœud agrégé d'un niveau de détail (voir Octree::levelOfDetail)
+struct LodCell {
+    Vector3D centerOfMass;
+    float mass;       // Masse totale
+    uint32_t count;   // Nombre de particules
+    Vector3D min;     // Coin inférieur du volume
+    Vector3D size;    // Dimensions du volume
+};
 
 // Classe Octree pour Barnes-Hut en 3D
+// Les particules sont triées spatialement (ordre des feuilles en profondeur) dans des colonnes
+// tenues par la racine ; chaque nœud ne garde qu'un intervalle [begin, begin + count) d'indices 32 bits.
 class Octree {
+    friend class FMMSolver;        // Le FMM s'appuie sur la hiérarchie de l'octree
+    friend class InteractionCache; // Listes d'interaction construites sur le tableau aplati
+    friend class DistributedSimulation; // Branches essentielles envoyées aux autres rangs MPI
 private:
     float x, y, z, width, height, depth;
     int capacity;
-    std::vector<const Particle*> particles; // Pointeurs vers des particules
+    uint32_t begin, count; // Intervalle des particules du sous-arbre dans les colonnes triées
+    bool leaf;
     Octree* children[8] = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
 
     float totalMass;       // Masse totale dans ce volume
     Vector3D centerOfMass; // Centre de masse du volume
 
+    // Nœud compact de l'octree aplati en profondeur (32 octets)
+    // Les enfants suivent immédiatement leur parent ; next pointe après le sous-arbre (lien de saut).
+    // Une feuille vérifie donc next == indice + 1.
+    struct FlatNode {
+        float comX, comY, comZ; // Centre de masse
+        float mass;             // Masse totale
+        float sizeSq;           // Carré de la taille du volume (0 pour une feuille)
+        uint32_t next;          // Indice du nœud suivant hors du sous-arbre
+        uint32_t begin;         // Première particule du nœud dans les colonnes triées
+        uint32_t leafCount;     // Nombre de particules pour une feuille, 0 pour un nœud interne
+    };
+    InterleavedVector<FlatNode> flatNodes; // Tableau aplati (rempli uniquement pour la racine), lu par tous les threads
+
+    // Nœud large : les 8 enfants d'un nœud interne rangés en colonnes (une voie AVX par enfant)
+    // pour évaluer le critère d'ouverture et les monopôles des 8 enfants en un seul groupe d'instructions.
+    // Feuilles et voies vides ont une taille négative : le critère les accepte pour tout theta >= 0
+    // (une voie vide a une masse nulle), sans masque supplémentaire ni enfant -1 empilé.
+    struct WideNode {
+        float comX[8], comY[8], comZ[8]; // Centres de masse des enfants
+        float mass[8];                    // Masses des enfants
+        float sizeSq[8];                  // Carrés des tailles (-1 pour une feuille ou une voie vide)
+        uint32_t direct[8];               // Masque (tous bits à 1) des feuilles à sommer directement
+        int32_t child[8];                 // Nœud large des enfants d'un enfant interne, -1 sinon
+        uint32_t begin[8], leafCount[8];  // Intervalle des particules des feuilles
+    };
+    InterleavedVector<WideNode> wideNodes; // Rempli uniquement pour la racine (le nœud 0 contient la racine)
+    bool wideTraversal;              // Parcours par nœuds larges plutôt que tableau aplati
+    float openingSq;                 // Carré du critère d'ouverture (theta_sq par défaut)
+
+    // Colonnes des particules triées spatialement (remplies uniquement pour la racine)
+    std::vector<uint32_t> sortedIndex; // Indice de la particule dans le vecteur d'origine
+    ArenaVector<float> sortedX, sortedY, sortedZ, sortedMass; // Remplies par le pool (premier contact réparti)
+
     static std::vector<const Octree*> instances; // Pile pour la gestion des instances de l'octree
+    static std::mutex instancesMutex;            // Les sous-arbres sont construits en parallèle
+
+    // Profondeur maximale : au-delà (particules confondues), le nœud reste une feuille
+    static const int MAX_DEPTH = 32;
+    // Taille minimale d'un sous-arbre construit ou rafraîchi dans sa propre tâche
+    static const uint32_t TASK_GRAIN = 4096;
+
+    // Construit récursivement la topologie du sous-arbre sur order[begin, begin + count) (tri par octant en place)
+    // Positions : accès aux coordonnées par indice d'origine (particules ou colonnes, voir Octree.cxx) ;
+    // parallel : gros sous-arbres en tâches du pool partagé
+    template <class Positions>
+    void buildNode(const Positions &positions, std::vector<uint32_t> &order,
+                   std::vector<uint32_t> &scratch, uint32_t begin, uint32_t count, int level, bool parallel);
+    // Recalcule les moments du sous-arbre depuis les colonnes triées de la racine (topologie inchangée)
+    void refreshNode(const Octree &root, bool parallel);
+    // Recopie les particules de l'octree dans les colonnes triées
+    void gatherColumns(const std::vector<Particle> &particles);
+    // Crée le sous-volume correspondant à un octant
+    Octree* createChild(int octant) const;
+    // Écrit le nœud et son sous-arbre dans flatNodes
+    void flattenNode(const Octree *node);
+    // Écrit un nœud large pour les voies données (et récursivement leurs enfants), renvoie son indice
+    int32_t buildWideNode(const Octree *const *lanes, int nbLanes);
+    // Parcours Barnes-Hut sur les nœuds larges (AVX si disponible)
+    Vector3D computeAccelerationWide(const Particle &p, uint32_t &interactions) const;
+    // Distance au carré d'un point au volume du nœud (0 à l'intérieur)
+    float distanceSq(const Vector3D &point) const;
+    // Parcours des requêtes spatiales (root : colonnes triées de la racine)
+    void collectBox(const Octree &root, const Vector3D &min, const Vector3D &max, std::vector<uint32_t> &found) const;
+    void collectRadius(const Octree &root, const Vector3D &center, float radiusSq, std::vector<uint32_t> &found) const;
+    // Parcours du niveau de détail à profondeur fixe
+    void collectDepth(const Octree &root, int levels, uint32_t sparse, std::vector<LodCell> &cells, std::vector<uint32_t> &found) const;
 public:
     Octree(float x, float y, float z, float width, float height, float depth, int capacity);
     ~Octree();
 
     // Vérifie si la particule se trouve dans le volume de l'octree
     bool contains(const Particle *p) const;
-    // Découpe le volume en 8 sous-volumes (octants)
-    void subdivide();
-    // Insertion d'une particule dans l'octree
-    void insert(const Particle* p);
-    // Détermine dans quel octant se trouve une particule
-    int getOctant(const Particle* p) const;
+    // Reconstruit l'octree à partir de l'ensemble des particules puis l'aplatit (buildTopology puis computeMoments)
+    void build(const std::vector<Particle> &particles);
+    // Subdivision et colonnes triées seulement (les moments sont calculés par computeMoments)
+    void buildTopology(const std::vector<Particle> &particles);
+    // Topologie et colonnes triées sur des colonnes de positions et de masses (index des requêtes spatiales) ;
+    // ni moments ni disposition de parcours. En série : appelé par les threads du serveur, il ne prend ni
+    // le pool de la simulation (cœurs réservés à l'API) ni le risque d'un configure() concurrent
+    void build(const float *px, const float *py, const float *pz, const float *mass, std::size_t n);
+    // Passe montante des moments (masse, centre de masse) sans disposition de parcours (niveau de détail), en série
+    void computeMassMoments();
+    // Passe montante des moments (masse, centre de masse) puis disposition pour le parcours
+    void computeMoments();
+    // Met à jour colonnes et moments avec les positions courantes sans reconstruire la topologie
+    // (les particules restent dans leur feuille d'origine ; mêmes particules qu'au dernier build)
+    void refresh(const std::vector<Particle> &particles);
+    // Aplatit l'arbre construit en tableau compact en profondeur avec liens de saut
+    void flatten();
+    // Construit la disposition en nœuds larges (8 enfants en colonnes)
+    void buildWide();
+    // Choisit le parcours : nœuds larges SIMD (true) ou tableau aplati sans pile (false)
+    void setWideTraversal(bool wide);
+    // Critère d'ouverture Barnes-Hut de cet octree (theta de Gravity.hpp par défaut)
+    void setTheta(float theta);
+    // Détermine dans quel octant se trouve un point
+    int getOctant(float px, float py, float pz) const;
     // Calcule l'accélération sur une particule avec l'approximation Barnes-Hut
+    // (parcours linéaire sans pile du tableau aplati ou nœuds larges SIMD, les feuilles sont des flux contigus)
     Vector3D computeAcceleration(const Particle &p) const;
+    // Même calcul en comptant les interactions évaluées (coût de la particule pour l'équilibrage de charge)
+    Vector3D computeAcceleration(const Particle &p, uint32_t &interactions) const;
+    // Indices des particules de l'octree dans l'ordre spatial des feuilles
+    const std::vector<uint32_t>& spatialOrder() const;
+    // Requêtes spatiales sur l'octree construit (positions du dernier build), seuls les nœuds concernés sont visités ;
+    // renvoient les indices des particules dans le vecteur d'origine
+    // Particules dans la boîte [min, max]
+    void queryBox(const Vector3D &min, const Vector3D &max, std::vector<uint32_t> &found) const;
+    // Particules à une distance inférieure ou égale à radius de center
+    void queryRadius(const Vector3D &center, float radius, std::vector<uint32_t> &found) const;
+    // Les k particules les plus proches de center, de la plus proche à la plus lointaine : (distance au carré, indice)
+    std::vector<std::pair<float, uint32_t> > nearest(const Vector3D &center, std::size_t k) const;
+    // Niveau de détail (vue d'ensemble) : coupe de l'arbre en nœuds agrégés (LodCell) et particules isolées (found) ;
+    // un nœud d'au plus sparse particules est toujours remplacé par ses particules
+    // Nœuds à la profondeur levels sous la racine (ou feuilles moins profondes)
+    void levelOfDetail(int levels, uint32_t sparse, std::vector<LodCell> &cells, std::vector<uint32_t> &found) const;
+    // Au plus budget éléments (nœuds et particules) : les nœuds les plus peuplés sont ouverts en premier
+    void levelOfDetailBudget(std::size_t budget, uint32_t sparse, std::vector<LodCell> &cells, std::vector<uint32_t> &found) const;
+    // Tableaux de la racine pour le rapport de placement mémoire
+    std::vector<Arena::Region> arenaRegions() const;
     // Libère la mémoire et réinitialise l'octree
     void clear();
+    // clear() puis rend aussi la capacité des tableaux de la racine (octree inutilisé pour un moment)
+    void release();
+    // Nombre de nœuds de l'octree (racine comprise)
+    std::size_t nodeCount() const;
     // Affichage 3D de l'octree via OpenGL (affiche le volume sous forme de cube fil de fer)
     void drawGL() const;
     // We update the attributes of the octree
@@ -45,4 +172,4 @@ public:
     static void clearInstances();
 };
 
-#endif // OCTREE_H
\ No newline at end of file
+#endif // OCTREE_H
@@ -44,8 +44,11 @@ float Particle::getMass() const { return mass; }
 std::string Particle::getName() const { return name; }
 void Particle::setName(const std::string& n) { name = n; }
 int Particle::getId() const { return id; }
+void Particle::setId(int value) { id = value; }
 Vector3D Particle::getPosition() const { return position; }
 Vector3D Particle::getVelocity() const { return velocity; }
+void Particle::setPosition(const Vector3D &p) { position = p; }
+void Particle::setVelocity(const Vector3D &v) { velocity = v; }
 float Particle::getMasseVolumique() const { return masseVolumique; }
 void Particle::setMasseVolumique(float v) { masseVolumique = v; }
 std::string Particle::getColorHex() const { return colorHex; }
@@ -66,12 +69,34 @@ void Particle::updatePosition(float dt) {
 }
 // Gestion des conditions aux bords (rebond) en 3D
 void Particle::checkBoundary() {
+    checkBoundary(Vector3D(X_MIN, Y_MIN, Z_MIN), Vector3D(X_MAX, Y_MAX, Z_MAX));
+}
+void Particle::checkBoundary(const Vector3D &min, const Vector3D &max) {
+    if (position.x < min.x) { position.x = min.x; velocity.x = -velocity.x; }
+    else if (position.x > max.x) { position.x = max.x; velocity.x = -velocity.x; }
+    if (position.y < min.y) { position.y = min.y; velocity.y = -velocity.y; }
+    else if (position.y > max.y) { position.y = max.y; velocity.y = -velocity.y; }
+    if (position.z < min.z) { position.z = min.z; velocity.z = -velocity.z; }
+    else if (position.z > max.z) { position.z = max.z; velocity.z = -velocity.z; }
+}
+
+// Variantes planes (mode 2D) : seules les composantes (x, y) évoluent
+void Particle::updateVelocity2D(float dt) {
+    velocity.x += acceleration.x * dt;
+    velocity.y += acceleration.y * dt;
+}
+void Particle::updatePosition2D(float dt) {
+    position.x += velocity.x * dt;
+    position.y += velocity.y * dt;
+    history.push_back(position);
+    if (history.size() > 200)
+        history.pop_front();
+}
+void Particle::checkBoundary2D() {
     if (position.x < X_MIN) { position.x = X_MIN; velocity.x = -velocity.x; }
     else if (position.x > X_MAX) { position.x = X_MAX; velocity.x = -velocity.x; }
     if (position.y < Y_MIN) { position.y = Y_MIN; velocity.y = -velocity.y; }
     else if (position.y > Y_MAX) { position.y = Y_MAX; velocity.y = -velocity.y; }
-    if (position.z < Z_MIN) { position.z = Z_MIN; velocity.z = -velocity.z; }
-    else if (position.z > Z_MAX) { position.z = Z_MAX; velocity.z = -velocity.z; }
 }
 
 // Affichage 3D via OpenGL
@@ -93,38 +118,4 @@ void Particle::drawGL() const {
     #endif
 }
 
-void Particle::saveState(float time, float rewind_max_history, std::mutex &mtx) {
-    std::lock_guard<std::mutex> lock(mtx);
-    state_history.push_back({position, velocity, time});
-    // On garde seulement les 5 dernières secondes
-    while (rewind_max_history != -1 && !state_history.empty() && (time - state_history.front().time) > rewind_max_history) {
-        state_history.pop_front();
-    }
-}
-
-
-bool Particle::restoreState(float target_time, std::mutex &mtx) {
-    std::lock_guard<std::mutex> lock(mtx);
-    if (state_history.empty()) return false;
-    // Cherche le dernier état <= target_time
-    for (auto it = state_history.rbegin(); it != state_history.rend(); ++it) {
-        if (it->time <= target_time) {
-            position = it->position;
-            velocity = it->velocity;
-            return true;
-        }
-    }
-    // Si aucun état trouvé, restaure le plus ancien
-    position = state_history.front().position;
-    velocity = state_history.front().velocity;
-    return false;
-}
-
-const std::deque<ParticleState>& Particle::getStateHistory() const {
-    return state_history;
-}
-
-
-
-
-int Particle::id_counter = 0;
\ No newline at end of file
+std::atomic<int> Particle::id_counter(0);
\ No newline at end of file
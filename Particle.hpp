@@ -4,7 +4,7 @@
 #include <iostream>
 #include <cmath>
 #include <deque>
-#include <mutex>
+#include <atomic>
 
 // Structure de vecteur en 3D
 struct Vector3D {
@@ -22,11 +22,6 @@ struct Vector3D {
     Vector3D &operator/=(float scalar) { x /= scalar; y /= scalar; z /= scalar; return *this; }
     float norm() const { return std::sqrt(x * x + y * y + z * z); }
 };
-struct ParticleState {
-    Vector3D position;
-    Vector3D velocity;
-    float time;
-};
 // Classe représentant une particule en 3D
 class Particle {
     Vector3D position;
@@ -39,13 +34,12 @@ class Particle {
     int id;
    
     std::deque<Vector3D> history;
-    std::deque<ParticleState> state_history;
     
 public:
     Particle();
     Particle(float x, float y, float z, float vx, float vy, float vz, float mass, float masseVolumique = 1.0f, std::string colorHex = "");
     ~Particle();
-    static int id_counter; // Identifiant unique pour chaque particule
+    static std::atomic<int> id_counter; // Identifiant unique pour chaque particule (API, sessions et simulation en parallèle)
 
     // Accesseurs
     float x() const;
@@ -61,11 +55,12 @@ public:
     void setMasseVolumique(float v);
     void setColorHex(const std::string &color);
     int getId() const;
+    void setId(int value); // Identifiant imposé (particules rechargées par l'API, échanges entre processus)
     Vector3D getPosition() const;
     Vector3D getVelocity() const;
-    void saveState(float time, float rewind_max_history, std::mutex &mtx);
-    bool restoreState(float target_time, std::mutex &mtx);
-    const std::deque<ParticleState>& getStateHistory() const;
+    // Restauration d'un état enregistré (voir HistoryBuffer)
+    void setPosition(const Vector3D &p);
+    void setVelocity(const Vector3D &v);
 
     // Réinitialise l'accélération pour la nouvelle itération
     void resetAcceleration();
@@ -77,6 +72,13 @@ public:
     void updatePosition(float dt);
     // Gestion des conditions aux bords (rebond) en 3D
     void checkBoundary();
+    // Même rebond sur une boîte donnée (sessions de l'API, indépendantes des bornes globales)
+    void checkBoundary(const Vector3D &min, const Vector3D &max);
+
+    // Variantes planes (mode 2D) : seules les composantes (x, y) évoluent
+    void updateVelocity2D(float dt);
+    void updatePosition2D(float dt);
+    void checkBoundary2D();
 
     // Affichage 3D via OpenGL
     void drawGL() const;
@@ -0,0 +1,205 @@
+#include "Quadtree.hpp"
+#include "Gravity.hpp"
+
+// Pour OpenGL sur macOS ou autres
+#ifdef DISPLAY_VERSION
+
+#ifdef __APPLE__
+#include <OpenGL/glu.h>
+#else
+#include <GL/glu.h>
+#endif
+
+#endif
+
+#include <cmath>
+#include <cstdlib>
+
+// Définition de la variable statique
+std::vector<const Quadtree*> Quadtree::instances;
+
+Quadtree::Quadtree(float x, float y, float width, float height, int capacity)
+    : x(x), y(y), width(width), height(height), capacity(capacity), level(0),
+        totalMass(0.f), comX(0.f), comY(0.f) {}
+
+Quadtree::~Quadtree() { clear(); }
+
+void Quadtree::updateAttributes(float newX, float newY, float newWidth, float newHeight, int newCapacity)
+{
+    x = newX;
+    y = newY;
+    width = newWidth;
+    height = newHeight;
+    capacity = newCapacity;
+
+    // Réinitialisation des attributs de masse et centre de masse
+    totalMass = 0.f;
+    comX = 0.f;
+    comY = 0.f;
+}
+
+// Vérifie si la particule se trouve dans la surface du quadtree
+bool Quadtree::contains(const Particle *p) const {
+    return (p->x() >= x && p->x() < x + width &&
+            p->y() >= y && p->y() < y + height);
+}
+
+// Découpe la surface en 4 sous-surfaces (quadrants)
+void Quadtree::subdivide() {
+    float hw = width * 0.5f;
+    float hh = height * 0.5f;
+    children[0] = new Quadtree(x, y, hw, hh, capacity);
+    children[1] = new Quadtree(x + hw, y, hw, hh, capacity);
+    children[2] = new Quadtree(x, y + hh, hw, hh, capacity);
+    children[3] = new Quadtree(x + hw, y + hh, hw, hh, capacity);
+    for (int i = 0; i < 4; i++)
+        children[i]->level = level + 1;
+}
+
+// Insertion d'une particule dans le quadtree
+void Quadtree::insert(const Particle* p) {
+    if (!contains(p))
+        return;
+
+    // Mise à jour du centre de masse
+    float pMass = p->getMass();
+    float newTotalMass = totalMass + pMass;
+    comX = (comX * totalMass + p->x() * pMass) / newTotalMass;
+    comY = (comY * totalMass + p->y() * pMass) / newTotalMass;
+    totalMass = newTotalMass;
+
+    // À la profondeur maximale, la feuille garde toutes ses particules (même position plane)
+    if (children[0] == nullptr && (particles.size() < static_cast<unsigned>(capacity) || level >= MAX_DEPTH)) {
+        particles.push_back(p);
+    } else {
+        if (children[0] == nullptr) {
+            subdivide();
+            // Réinsertion des particules existantes dans les sous-surfaces
+            for (auto existing : particles) {
+                children[getQuadrant(existing)]->insert(existing);
+            }
+            particles.clear();
+        }
+        children[getQuadrant(p)]->insert(p);
+    }
+}
+
+// Reconstruit le quadtree à partir de l'ensemble des particules
+void Quadtree::build(const std::vector<Particle> &particles) {
+    clear();
+    for (const auto &p : particles) {
+        insert(&p);
+    }
+}
+
+// Détermine dans quel quadrant se trouve une particule
+int Quadtree::getQuadrant(const Particle* p) const {
+    float midX = x + width * 0.5f;
+    float midY = y + height * 0.5f;
+    int quad = 0;
+    if (p->x() >= midX) quad |= 1;
+    if (p->y() >= midY) quad |= 2;
+    return quad;
+}
+
+// Calcule l'accélération plane (z = 0) sur une particule avec l'approximation Barnes-Hut
+Vector3D Quadtree::computeAcceleration(const Particle &p) const {
+    float accX = 0.f, accY = 0.f;
+    float px = p.x(), py = p.y();
+    // Parcours en profondeur : au plus 3 nœuds en attente par niveau, plus les 4 fils du dernier
+    const Quadtree* stack[4 * (MAX_DEPTH + 1)];
+    int top = 0;
+    stack[top++] = this;
+
+    while (top > 0) {
+        const Quadtree* node = stack[--top];
+        if (node->totalMass == 0.f)
+            continue;
+
+        float dx = node->comX - px;
+        float dy = node->comY - py;
+        float dist_sq_eps = dx * dx + dy * dy + epsilon_sq;
+
+        if (node->children[0] != nullptr) { // Nœud interne
+            float size = std::max(node->width, node->height);
+            if ((size * size) < (theta_sq * dist_sq_eps)) {
+                float invDistCube = G * node->totalMass / (dist_sq_eps * std::sqrt(dist_sq_eps));
+                accX += dx * invDistCube;
+                accY += dy * invDistCube;
+            } else {
+                for (int j = 0; j < 4; j++) {
+                    if (node->children[j] != nullptr)
+                        stack[top++] = node->children[j];
+                }
+            }
+        } else { // Nœud feuille
+            if (node->particles.size() == 1 && node->particles[0] == &p)
+                continue;
+            float invDistCube = G * node->totalMass / (dist_sq_eps * std::sqrt(dist_sq_eps));
+            accX += dx * invDistCube;
+            accY += dy * invDistCube;
+        }
+    }
+    return Vector3D(accX, accY, 0.f);
+}
+
+// Libère la mémoire et réinitialise le quadtree
+void Quadtree::clear() {
+    particles.clear();
+    for (int i = 0; i < 4; i++) {
+        if (children[i] != nullptr) {
+            children[i]->clear();
+            delete children[i];
+            children[i] = nullptr;
+        }
+    }
+    totalMass = 0.f;
+    comX = 0.f;
+    comY = 0.f;
+}
+
+// We override the new operator to manage instances of Quadtree
+void* Quadtree::operator new(std::size_t size) {
+    if (!instances.empty()) {
+        const Quadtree* instance = instances.back();
+        instances.pop_back();
+        return (void*)instance;
+    }
+    return ::operator new(size);
+}
+
+void Quadtree::operator delete(void* ptr) {
+    instances.push_back(static_cast<const Quadtree*>(ptr));
+}
+
+// We to a static method to clear all instances for real deallocation
+void Quadtree::clearInstances() {
+    for (const Quadtree* instance : instances) {
+        ::operator delete(const_cast<Quadtree*>(instance));
+    }
+    instances.clear();
+}
+
+// Affichage via OpenGL (rectangles fil de fer dans le plan z = zPlane)
+void Quadtree::drawGL(float zPlane) const {
+    #ifdef DISPLAY_VERSION
+    glColor3f(0.f, 0.f, 1.f);
+    float x0 = x, y0 = y;
+    float x1 = x + width, y1 = y + height;
+    glBegin(GL_LINE_LOOP);
+        glVertex3f(x0, y0, zPlane);
+        glVertex3f(x1, y0, zPlane);
+        glVertex3f(x1, y1, zPlane);
+        glVertex3f(x0, y1, zPlane);
+    glEnd();
+    // Affichage récursif des sous-surfaces
+    if (children[0] != nullptr) {
+        for (int i = 0; i < 4; i++) {
+            if (children[i] != nullptr)
+                children[i]->drawGL(zPlane);
+        }
+    }
+    #else
+    (void)zPlane;
+    #endif // DISPLAY_VERSION
+}
@@ -0,0 +1,56 @@
+#ifndef QUADTREE_H
+#define QUADTREE_H
+
+#include <vector>
+
+#include "Particle.hpp"
+
+// Classe Quadtree pour Barnes-Hut en 2D (systèmes quasi plans)
+// Seules les composantes (x, y) sont utilisées : 4 sous-volumes par nœud au lieu de 8.
+class Quadtree {
+public:
+    // Profondeur maximale : au-delà, la demi-largeur d'un nœud approche la précision des float
+    // et des particules de même (x, y) (projection de points ne différant qu'en z) se subdiviseraient sans fin
+    static const int MAX_DEPTH = 20;
+private:
+    float x, y, width, height;
+    int capacity;
+    int level; // Profondeur du nœud (0 pour la racine)
+    std::vector<const Particle*> particles; // Pointeurs vers des particules
+    Quadtree* children[4] = {nullptr, nullptr, nullptr, nullptr};
+
+    float totalMass;  // Masse totale dans cette surface
+    float comX, comY; // Centre de masse de la surface
+
+    static std::vector<const Quadtree*> instances; // Pile pour la gestion des instances du quadtree
+public:
+    Quadtree(float x, float y, float width, float height, int capacity);
+    ~Quadtree();
+
+    // Vérifie si la particule se trouve dans la surface du quadtree
+    bool contains(const Particle *p) const;
+    // Découpe la surface en 4 sous-surfaces (quadrants)
+    void subdivide();
+    // Insertion d'une particule dans le quadtree
+    void insert(const Particle* p);
+    // Reconstruit le quadtree à partir de l'ensemble des particules
+    void build(const std::vector<Particle> &particles);
+    // Détermine dans quel quadrant se trouve une particule
+    int getQuadrant(const Particle* p) const;
+    // Calcule l'accélération plane (z = 0) sur une particule avec l'approximation Barnes-Hut
+    Vector3D computeAcceleration(const Particle &p) const;
+    // Libère la mémoire et réinitialise le quadtree
+    void clear();
+    // Affichage via OpenGL (rectangles fil de fer dans le plan z = zPlane)
+    void drawGL(float zPlane) const;
+    // We update the attributes of the quadtree
+    void updateAttributes(float newX, float newY, float newWidth, float newHeight, int newCapacity);
+    // We override the new operator to manage instances of Quadtree
+    void* operator new(std::size_t size);
+    // We override the delete operator to manage instances of Quadtree
+    void operator delete(void* ptr);
+    // We to a static method to clear all instances for real deallocation
+    static void clearInstances();
+};
+
+#endif // QUADTREE_H
@@ -0,0 +1,287 @@
+#include "Session.hpp"
+#include "MyRNG.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+// Taille des tâches des boucles sur les particules
+static const std::size_t PARTICLE_GRAIN = 1024;
+
+Session::Session(const std::string &id, const SimulationSettings &initial, int nbParticles, unsigned seed, bool paused, const SessionLimits &limits)
+    : name(id),
+      tree(initial.MIN_X, initial.MIN_Y, initial.MIN_Z, initial.MAX_X - initial.MIN_X, initial.MAX_Y - initial.MIN_Y, initial.MAX_Z - initial.MIN_Z, 1),
+      settings(initial),
+      control([this]() {
+                  step();
+                  settings.current_time += settings.dt;
+              },
+              [this]() { return settings.t_total == -1 || settings.current_time < settings.t_total; },
+              []() {},
+              paused),
+      rng(seed),
+      simulation{tree, particles, history, snapshots, settings, control, [this]() { return randomParticle(); },
+                 false, limits.maxParticles, limits.maxHistory},
+      steps(0) {
+    settings.nb_particles = nbParticles;
+    settings.current_time = 0.f;
+    settings.closed = false;
+    if (limits.maxHistory > 0.f)
+        settings.rewind_max_history = std::min(settings.rewind_max_history, limits.maxHistory);
+    particles.reserve(nbParticles + 1);
+    for (int i = 0; i < nbParticles; i++)
+        particles.push_back(randomParticle());
+    particles.push_back(Particle(0.5f * (settings.MIN_X + settings.MAX_X), 0.5f * (settings.MIN_Y + settings.MAX_Y),
+                                 0.5f * (settings.MIN_Z + settings.MAX_Z), 0.f, 0.f, 0.f, 1e13));
+    // Identifiants propres à la session (le compteur global sert à la simulation principale)
+    for (std::size_t i = 0; i < particles.size(); i++)
+        particles[i].setId(static_cast<int>(i));
+    snapshots.publishParticles(particles, settings, history);
+}
+
+// Tirage dans la boîte courante de la session (graine de la session)
+Particle Session::randomParticle() {
+    boost::random::uniform_real_distribution<float> posX(settings.MIN_X, settings.MAX_X);
+    boost::random::uniform_real_distribution<float> posY(settings.MIN_Y, settings.MAX_Y);
+    boost::random::uniform_real_distribution<float> posZ(settings.MIN_Z, settings.MAX_Z);
+    boost::random::uniform_real_distribution<float> velocity(vitesseMin, vitesseMax);
+    boost::random::uniform_real_distribution<float> mass(massMin, massMax);
+    float x = posX(rng), y = posY(rng), z = posZ(rng);
+    float vx = velocity(rng), vy = velocity(rng), vz = velocity(rng);
+    return Particle(x, y, z, vx, vy, vz, mass(rng));
+}
+
+// Un pas complet, dans le thread de l'ordonnanceur
+void Session::step() {
+    float time = settings.current_time;
+    float dt = settings.dt;
+    Vector3D boxMin(settings.MIN_X, settings.MIN_Y, settings.MIN_Z);
+    Vector3D boxMax(settings.MAX_X, settings.MAX_Y, settings.MAX_Z);
+    tree.updateAttributes(boxMin.x, boxMin.y, boxMin.z, boxMax.x - boxMin.x, boxMax.y - boxMin.y, boxMax.z - boxMin.z, 1);
+    tree.build(particles);
+    TaskPool &pool = TaskPool::global();
+    pool.parallelFor(0, particles.size(), PARTICLE_GRAIN, [&](std::size_t i) {
+        particles[i].resetAcceleration();
+        particles[i].addAcceleration(tree.computeAcceleration(particles[i]));
+    });
+    pool.parallelFor(0, particles.size(), PARTICLE_GRAIN, [&](std::size_t i) {
+        particles[i].updateVelocity(dt);
+        particles[i].updatePosition(dt);
+        particles[i].checkBoundary(boxMin, boxMax);
+    });
+    history.record(particles, time, settings.rewind_max_history);
+    SimulationSettings published = settings;
+    published.current_time = time + dt;
+    snapshots.publishStep(particles, published, history);
+    steps++;
+}
+
+SessionManager::SessionManager(const SessionLimits &limits, const SimulationSettings &defaults)
+    : bounds(limits), defaults(defaults), created(0), clock(0.), closing(false), stopping(false) {}
+
+SessionManager::~SessionManager() {
+    stop();
+}
+
+void SessionManager::start() {
+    closing = stopping = false;
+    scheduler = std::thread([this]() { schedulerLoop(); });
+}
+
+// Arrête toutes les sessions puis l'ordonnanceur
+void SessionManager::stop() {
+    if (!scheduler.joinable())
+        return;
+    std::vector<std::shared_ptr<Session> > all;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        closing = true;
+        for (auto &entry : sessions) {
+            entry.second.suspended = false;
+            all.push_back(entry.second.session);
+        }
+    }
+    // Les commandes d'arrêt sont appliquées par l'ordonnanceur ; les suivantes s'exécutent directement
+    for (auto &session : all)
+        session->controller().stop();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    scheduler.join();
+    for (auto &session : all)
+        session->control.detach();
+}
+
+std::shared_ptr<Session> SessionManager::create(const std::string &id, const SimulationSettings &settings, int nbParticles, unsigned seed, bool paused) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (sessions.count(id))
+            throw std::invalid_argument("session existante : " + id);
+        if (static_cast<int>(sessions.size()) >= bounds.maxSessions)
+            throw std::length_error("nombre maximal de sessions atteint");
+    }
+    // Construite hors du verrou (tirage des particules) ; l'unicité est vérifiée à nouveau à l'insertion
+    std::shared_ptr<Session> session = std::make_shared<Session>(id, settings, nbParticles, seed, paused, bounds);
+    session->controller().setWakeHook([this]() {
+        std::lock_guard<std::mutex> lock(mtx);
+        wakeUp.notify_all();
+    });
+    std::lock_guard<std::mutex> lock(mtx);
+    if (sessions.count(id))
+        throw std::invalid_argument("session existante : " + id);
+    if (static_cast<int>(sessions.size()) >= bounds.maxSessions)
+        throw std::length_error("nombre maximal de sessions atteint");
+    Entry entry{session, clock, false, Clock::now()};
+    sessions[id] = entry;
+    created++;
+    wakeUp.notify_all();
+    return session;
+}
+
+// Session active (réveillée si suspendue), nullptr si inconnue
+std::shared_ptr<Session> SessionManager::acquire(const std::string &id) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = sessions.find(id);
+    if (it == sessions.end())
+        return nullptr;
+    Entry &entry = it->second;
+    entry.lastAccess = Clock::now();
+    if (entry.suspended) {
+        entry.suspended = false;
+        entry.cpuSeconds = std::max(entry.cpuSeconds, clock);
+        wakeUp.notify_all();
+    }
+    return entry.session;
+}
+
+bool SessionManager::remove(const std::string &id) {
+    std::shared_ptr<Session> session = acquire(id);
+    if (!session)
+        return false;
+    // Arrêt appliqué par l'ordonnanceur tant que la session est encore dans la table
+    session->controller().stop();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        sessions.erase(id);
+    }
+    // Plus jamais ordonnancée : les commandes des requêtes encore en cours s'exécutent directement
+    std::lock_guard<std::mutex> hold(stepMtx);
+    session->control.detach();
+    return true;
+}
+
+SessionInfo SessionManager::describe(const Entry &entry, Clock::time_point now) const {
+    const Session &session = *entry.session;
+    SnapshotPublisher::Reader snapshot(session.snapshots);
+    SessionInfo info;
+    info.id = session.id();
+    switch (entry.session->control.state()) {
+    case SimulationController::PAUSED: info.state = "paused"; break;
+    case SimulationController::FINISHED: info.state = "finished"; break;
+    case SimulationController::STOPPED: info.state = "stopped"; break;
+    default: info.state = "running"; break;
+    }
+    // Le contrôleur ne relève la fin de la durée qu'au passage suivant de l'ordonnanceur
+    const SimulationSettings &published = snapshot->settings;
+    if (info.state == "running" && published.t_total != -1 && published.current_time >= published.t_total)
+        info.state = "finished";
+    if (entry.suspended)
+        info.state = "suspended";
+    info.particles = static_cast<int>(snapshot->state->size());
+    info.currentTime = snapshot->settings.current_time;
+    info.steps = session.steps;
+    info.cpuSeconds = entry.cpuSeconds;
+    info.idleSeconds = std::chrono::duration<double>(now - entry.lastAccess).count();
+    return info;
+}
+
+std::vector<SessionInfo> SessionManager::list() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<SessionInfo> infos;
+    Clock::time_point now = Clock::now();
+    for (const auto &entry : sessions)
+        infos.push_back(describe(entry.second, now));
+    return infos;
+}
+
+bool SessionManager::info(const std::string &id, SessionInfo &out) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = sessions.find(id);
+    if (it == sessions.end())
+        return false;
+    out = describe(it->second, Clock::now());
+    return true;
+}
+
+// Identifiant libre pour une session créée sans identifiant
+std::string SessionManager::nextId() {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::string id;
+    long k = created;
+    do {
+        id = "s" + std::to_string(++k);
+    } while (sessions.count(id));
+    return id;
+}
+
+// Aucun pas de session en cours tant que le verrou est tenu
+std::unique_lock<std::mutex> SessionManager::quiesce() {
+    return std::unique_lock<std::mutex>(stepMtx);
+}
+
+// Suspend les sessions sans requête depuis idleTimeout (mtx tenu, entre deux pas)
+void SessionManager::suspendIdle(Clock::time_point now) {
+    if (bounds.idleTimeout <= 0.f || closing)
+        return;
+    for (auto &entry : sessions) {
+        Entry &e = entry.second;
+        if (e.suspended || std::chrono::duration<double>(now - e.lastAccess).count() < bounds.idleTimeout)
+            continue;
+        e.suspended = true;
+        // Aucun pas en cours ni à venir : l'octree est reconstruit au réveil
+        e.session->tree.release();
+        printf("Session %s suspendue (inactive depuis %.0f s)\n", entry.first.c_str(), bounds.idleTimeout);
+    }
+}
+
+// Boucle de l'ordonnanceur : un pas de la session active qui a consommé le moins de temps de calcul
+void SessionManager::schedulerLoop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!stopping) {
+        Clock::time_point now = Clock::now();
+        suspendIdle(now);
+        Entry *next = nullptr;
+        for (auto &entry : sessions) {
+            Entry &e = entry.second;
+            if (e.suspended || !e.session->control.hasWork())
+                continue;
+            if (next == nullptr || e.cpuSeconds < next->cpuSeconds)
+                next = &e;
+        }
+        if (next == nullptr) {
+            // Réveil par une commande, une création ou une requête sur une session suspendue ;
+            // sinon une fois par seconde pour les suspensions
+            wakeUp.wait_for(lock, std::chrono::seconds(1));
+            continue;
+        }
+        // Temps consommé au moins égal à celui de la session précédente : une session restée
+        // en pause ne rattrape pas son retard au détriment des autres
+        next->cpuSeconds = std::max(next->cpuSeconds, clock - 0.05);
+        std::shared_ptr<Session> session = next->session;
+        lock.unlock();
+        Clock::time_point start = Clock::now();
+        {
+            std::lock_guard<std::mutex> hold(stepMtx);
+            session->control.poll();
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        lock.lock();
+        auto it = sessions.find(session->id());
+        if (it != sessions.end() && it->second.session == session) {
+            it->second.cpuSeconds += elapsed;
+            clock = it->second.cpuSeconds;
+        }
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef SESSION_HPP
+#define SESSION_HPP
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <atomic>
+
+#include <boost/random.hpp>
+
+#include "Particle.hpp"
+#include "Octree.hpp"
+#include "HistoryBuffer.hpp"
+#include "Snapshot.hpp"
+#include "SimulationSettings.hpp"
+#include "SimulationController.hpp"
+#include "TaskPool.hpp"
+
+// Simulation servie par l'API : la simulation principale du processus ou une session
+struct SimulationContext {
+    Octree &tree;
+    std::vector<Particle> &particles;
+    HistoryBuffer &history;
+    SnapshotPublisher &snapshots;
+    SimulationSettings &settings;
+    SimulationController &controller;
+    std::function<Particle()> randomParticle; // Tirage dans la boîte courante (état neuf de /reset et nb_particles)
+    bool primary;       // Simulation principale : bornes globales (MyRNG) et pool de threads modifiables
+    int maxParticles;   // Limite du nombre de particules (0 : aucune)
+    float maxHistory;   // Limite de rewind_max_history en secondes (0 : aucune)
+};
+
+// Limites des sessions
+struct SessionLimits {
+    int maxSessions;    // Sessions simultanées (0 : sessions désactivées)
+    int maxParticles;   // Particules par session
+    float maxHistory;   // Durée maximale de l'historique par session
+    float idleTimeout;  // Suspension après ce délai sans requête, en secondes (0 : jamais)
+};
+
+// Session : simulation octree 3D indépendante (particules, historique, instantanés, paramètres, commandes)
+class Session {
+public:
+    Session(const std::string &id, const SimulationSettings &settings, int nbParticles, unsigned seed, bool paused, const SessionLimits &limits);
+
+    const std::string& id() const { return name; }
+    SimulationContext& context() { return simulation; }
+    SimulationController& controller() { return control; }
+
+private:
+    friend class SessionManager;
+
+    std::string name;
+    std::vector<Particle> particles;
+    Octree tree;
+    HistoryBuffer history;
+    SnapshotPublisher snapshots;
+    SimulationSettings settings;
+    SimulationController control;
+    boost::random::mt19937 rng;
+    SimulationContext simulation;
+    std::atomic<long> steps;
+
+    // Un pas complet (arbre, forces et intégration sur le pool partagé, historique, publication)
+    void step();
+    Particle randomParticle();
+};
+
+// Description d'une session pour GET /sessions
+struct SessionInfo {
+    std::string id;
+    std::string state;     // running/paused/finished/suspended
+    int particles;
+    float currentTime;
+    long steps;
+    double cpuSeconds;     // Temps de calcul consommé
+    double idleSeconds;    // Depuis la dernière requête
+};
+
+// Sessions de simulation et ordonnanceur équitable
+//
+// Un seul thread d'ordonnancement fait avancer les sessions, un pas à la fois, chacun parallélisé sur le
+// pool de tâches partagé : parmi les sessions qui ont du travail (commandes en attente ou simulation en
+// cours), il choisit celle qui a consommé le moins de temps de calcul. Une session qui redevient active
+// repart du temps consommé courant (pas de rattrapage au détriment des autres). Une session sans requête
+// depuis idleTimeout est suspendue : plus aucun pas, mémoire de l'octree rendue ; la requête suivante la
+// réveille.
+class SessionManager {
+public:
+    SessionManager(const SessionLimits &limits, const SimulationSettings &defaults);
+    ~SessionManager();
+
+    void start();
+    // Arrête toutes les sessions puis l'ordonnanceur
+    void stop();
+
+    // Nouvelle session ; lève std::invalid_argument si l'identifiant existe déjà,
+    // std::length_error si le nombre maximal de sessions est atteint
+    std::shared_ptr<Session> create(const std::string &id, const SimulationSettings &settings, int nbParticles, unsigned seed, bool paused);
+    // Session active (réveillée si suspendue), nullptr si inconnue
+    std::shared_ptr<Session> acquire(const std::string &id);
+    bool remove(const std::string &id);
+    std::vector<SessionInfo> list() const;
+    bool info(const std::string &id, SessionInfo &out) const;
+    // Identifiant libre pour une session créée sans identifiant
+    std::string nextId();
+    const SimulationSettings& defaultSettings() const { return defaults; }
+
+    // Aucun pas de session en cours tant que le verrou est tenu (redimensionnement du pool)
+    std::unique_lock<std::mutex> quiesce();
+    const SessionLimits& limits() const { return bounds; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry {
+        std::shared_ptr<Session> session;
+        double cpuSeconds;
+        bool suspended;
+        Clock::time_point lastAccess;
+    };
+
+    SessionLimits bounds;
+    SimulationSettings defaults;
+    std::map<std::string, Entry> sessions;
+    long created;
+    double clock;                  // Temps consommé de la dernière session ordonnancée
+    mutable std::mutex mtx;
+    std::mutex stepMtx;            // Tenu pendant le pas d'une session
+    std::condition_variable wakeUp;
+    std::thread scheduler;
+    bool closing;                  // Arrêt des sessions en cours : plus de suspension
+    bool stopping;
+
+    void schedulerLoop();
+    void suspendIdle(Clock::time_point now);
+    SessionInfo describe(const Entry &entry, Clock::time_point now) const;
+};
+
+#endif // SESSION_HPP
@@ -0,0 +1,148 @@
+#include "SimulationController.hpp"
+
+SimulationController::SimulationController(std::function<void()> step, std::function<bool()> canStep,
+                                           std::function<void()> settle, bool paused)
+    : step(step), canStep(canStep), settle(settle), paused(paused), stopped(false), finished(false), exited(false) {}
+
+// Applique la commande à la prochaine frontière de pas et attend son application
+void SimulationController::submit(Command command) {
+    std::shared_ptr<Pending> pending = std::make_shared<Pending>();
+    pending->command = command;
+    pending->done = false;
+    std::unique_lock<std::mutex> lock(mtx);
+    if (exited) {
+        // Plus de thread de simulation : la commande est appliquée directement
+        lock.unlock();
+        command();
+        return;
+    }
+    queue.push_back(pending);
+    wakeUp.notify_one();
+    if (wakeHook) {
+        // Sans mtx : le réveil peut prendre le verrou de l'ordonnanceur, qui appelle hasWork()
+        lock.unlock();
+        wakeHook();
+        lock.lock();
+    }
+    applied.wait(lock, [&pending]() { return pending->done; });
+    if (pending->error)
+        std::rethrow_exception(pending->error);
+}
+
+void SimulationController::pause() {
+    submit([this]() { paused = true; });
+}
+
+void SimulationController::resume() {
+    submit([this]() { paused = false; });
+}
+
+void SimulationController::stop() {
+    submit([this]() { stopped = true; });
+}
+
+void SimulationController::setPaused(bool value) { paused = value; }
+
+void SimulationController::setStopped() { stopped = true; }
+
+bool SimulationController::isPaused() const { return paused; }
+
+SimulationController::State SimulationController::state() const {
+    if (stopped)
+        return STOPPED;
+    if (paused)
+        return PAUSED;
+    return finished ? FINISHED : RUNNING;
+}
+
+// Commandes en attente, ou pas à faire ; pour un ordonnanceur externe
+bool SimulationController::hasWork() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!queue.empty())
+        return true;
+    return !stopped && !paused && canStep();
+}
+
+void SimulationController::setWakeHook(std::function<void()> hook) { wakeHook = hook; }
+
+// Applique les commandes en attente (thread de simulation) ; mtx tenu à l'entrée et à la sortie
+void SimulationController::applyCommands(std::unique_lock<std::mutex> &lock) {
+    if (queue.empty())
+        return;
+    std::deque<std::shared_ptr<Pending> > batch;
+    batch.swap(queue);
+    lock.unlock();
+    // Le pas précédent est entièrement terminé avant toute modification de l'état
+    settle();
+    for (auto &pending : batch) {
+        try {
+            pending->command();
+        } catch (...) {
+            pending->error = std::current_exception();
+        }
+    }
+    lock.lock();
+    for (auto &pending : batch)
+        pending->done = true;
+    applied.notify_all();
+}
+
+// Boucle de simulation dans le thread appelant, jusqu'à stop()
+void SimulationController::run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        applyCommands(lock);
+        if (stopped) {
+            // Les commandes déposées pendant l'arrêt sont encore appliquées ici
+            if (queue.empty())
+                break;
+            continue;
+        }
+        finished = !canStep();
+        if (paused || finished) {
+            lock.unlock();
+            settle();
+            lock.lock();
+            // En sommeil jusqu'à la prochaine commande
+            wakeUp.wait(lock, [this]() { return !queue.empty(); });
+            continue;
+        }
+        lock.unlock();
+        step();
+        lock.lock();
+    }
+    lock.unlock();
+    settle();
+    // Commandes déposées pendant settle() : appliquées avant de quitter, les suivantes le seront directement
+    lock.lock();
+    while (!queue.empty())
+        applyCommands(lock);
+    exited = true;
+}
+
+// Variante pour une boucle externe (affichage) : applique les commandes en attente puis fait un pas
+bool SimulationController::poll() {
+    std::unique_lock<std::mutex> lock(mtx);
+    applyCommands(lock);
+    while (stopped && !queue.empty())
+        applyCommands(lock);
+    if (stopped) {
+        exited = true;
+        return false;
+    }
+    finished = !canStep();
+    lock.unlock();
+    if (paused || finished)
+        settle();
+    else
+        step();
+    return true;
+}
+
+// Après stop(), quand plus aucune boucle externe n'appellera poll()
+void SimulationController::detach() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!queue.empty())
+        applyCommands(lock);
+    exited = true;
+}
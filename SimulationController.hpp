@@ -0,0 +1,78 @@
+#ifndef SIMULATIONCONTROLLER_HPP
+#define SIMULATIONCONTROLLER_HPP
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <memory>
+
+// Contrôle de la simulation par file de commandes
+//
+// Le thread de simulation est le seul à modifier l'état simulé : les commandes (API REST, affichage) sont
+// déposées dans une file et appliquées entre deux pas, après la fin du pas précédent (historique et
+// publication compris). En pause ou une fois la durée atteinte, le thread dort sur une variable de condition
+// jusqu'à la prochaine commande : aucune attente active.
+class SimulationController {
+public:
+    enum State { RUNNING, PAUSED, FINISHED, STOPPED };
+    typedef std::function<void()> Command;
+
+    // step : un pas complet ; canStep : faux une fois la durée de simulation atteinte ;
+    // settle : termine le travail différé du dernier pas avant une commande ou une mise en sommeil
+    SimulationController(std::function<void()> step, std::function<bool()> canStep, std::function<void()> settle, bool paused);
+
+    // Applique la commande à la prochaine frontière de pas et attend son application ;
+    // une exception levée par la commande est relancée dans le thread appelant
+    void submit(Command command);
+    void pause();
+    void resume();
+    void stop();
+    // Variantes à appeler depuis une commande (thread de simulation), sans attente
+    void setPaused(bool value);
+    void setStopped();
+
+    bool isPaused() const;
+    State state() const;
+    // Commandes en attente, ou pas à faire (ni pause, ni arrêt, durée non atteinte) ; pour un ordonnanceur externe
+    bool hasWork() const;
+    // Appelé après le dépôt de chaque commande (réveil d'un ordonnanceur externe qui appelle poll())
+    void setWakeHook(std::function<void()> hook);
+
+    // Boucle de simulation dans le thread appelant, jusqu'à stop()
+    void run();
+    // Variante pour une boucle externe (affichage) : applique les commandes en attente puis fait un pas
+    // si la simulation tourne ; renvoie faux après stop()
+    bool poll();
+    // Après stop(), quand plus aucune boucle externe n'appellera poll() : applique les commandes en attente,
+    // les suivantes s'exécutent directement dans le thread appelant
+    void detach();
+
+private:
+    struct Pending {
+        Command command;
+        bool done;
+        std::exception_ptr error;
+    };
+
+    std::function<void()> step;
+    std::function<bool()> canStep;
+    std::function<void()> settle;
+    std::function<void()> wakeHook;
+
+    mutable std::mutex mtx;
+    std::condition_variable wakeUp;   // Nouvelle commande pour le thread de simulation
+    std::condition_variable applied;  // Commande appliquée pour les threads appelants
+    std::deque<std::shared_ptr<Pending> > queue;
+    std::atomic<bool> paused;
+    std::atomic<bool> stopped;
+    std::atomic<bool> finished;
+    bool exited; // run() ou poll() a quitté la boucle après l'arrêt (mtx) : plus aucun thread de simulation
+
+    // Applique les commandes en attente (thread de simulation) ; mtx tenu à l'entrée et à la sortie
+    void applyCommands(std::unique_lock<std::mutex> &lock);
+};
+
+#endif // SIMULATIONCONTROLLER_HPP
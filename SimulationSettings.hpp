@@ -0,0 +1,23 @@
+#ifndef SIMULATIONSETTINGS_HPP
+#define SIMULATIONSETTINGS_HPP
+
+#include <string>
+
+// Paramètres de simulation partagés entre la boucle de simulation et l'API
+struct SimulationSettings {
+    float t_total;
+    float dt;
+    int nb_particles;
+    float current_time;
+    float rewind_max_history; // Durée maximale de l'historique de position des particules
+    bool closed;
+    float MAX_Y, MAX_X, MAX_Z;
+    float MIN_Y, MIN_X, MIN_Z;
+    float history_resolution;
+    int fmm_order; // Ordre des développements du solveur FMM
+    float load_imbalance; // Déséquilibre de charge du dernier pas (temps du thread le plus lent / moyenne)
+    int threads; // Nombre de threads de simulation
+    std::string affinity; // Placement des threads de simulation (none/compact/scatter/liste de cœurs)
+};
+
+#endif // SIMULATIONSETTINGS_HPP
@@ -0,0 +1,218 @@
+#include "Snapshot.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+std::shared_ptr<const std::string> SnapshotCache::get(const std::string &key, const std::function<std::string()> &encode) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto found = entries.find(key);
+    if (found != entries.end())
+        return found->second;
+    std::shared_ptr<const std::string> entry = std::make_shared<const std::string>(encode());
+    if (entries.size() < MAX_ENTRIES && bytes + entry->size() <= MAX_BYTES) {
+        entries[key] = entry;
+        bytes += entry->size();
+    }
+    return entry;
+}
+
+std::shared_ptr<const Octree> SnapshotCache::tree(const HistoryFrame &state, const std::vector<ParticleInfo> &info, bool moments) {
+    std::lock_guard<std::mutex> lock(treeMtx);
+    if (index) {
+        // Les requêtes en cours ne lisent pas les moments : ils peuvent être ajoutés à l'arbre partagé
+        if (moments && !indexMoments) {
+            index->computeMassMoments();
+            indexMoments = true;
+        }
+        return index;
+    }
+    // Cube englobant toutes les positions publiées (l'octree ignore les particules hors de son volume)
+    std::size_t n = std::min(state.size(), info.size());
+    std::vector<float> mass(n);
+    for (std::size_t i = 0; i < n; i++)
+        mass[i] = info[i].mass;
+    Vector3D min(0.f, 0.f, 0.f), max(0.f, 0.f, 0.f);
+    if (n > 0) {
+        min = max = Vector3D(state.x[0], state.y[0], state.z[0]);
+        for (std::size_t i = 1; i < n; i++) {
+            min = Vector3D(std::min(min.x, state.x[i]), std::min(min.y, state.y[i]), std::min(min.z, state.z[i]));
+            max = Vector3D(std::max(max.x, state.x[i]), std::max(max.y, state.y[i]), std::max(max.z, state.z[i]));
+        }
+    }
+    float size = std::max(std::max(max.x - min.x, max.y - min.y), max.z - min.z);
+    size = size * 1.001f + 1e-3f;
+    std::shared_ptr<Octree> built(new Octree(min.x, min.y, min.z, size, size, size, TREE_CAPACITY));
+    built->build(state.x.data(), state.y.data(), state.z.data(), mass.data(), n);
+    if (moments)
+        built->computeMassMoments();
+    indexMoments = moments;
+    index = built;
+    return index;
+}
+
+SnapshotPublisher::Reader::Reader(const SnapshotPublisher &publisher) : publisher(publisher), slot(-1), snapshot(nullptr) {
+    // Réserve un emplacement libre
+    while (slot < 0) {
+        for (int i = 0; i < MAX_READERS; i++) {
+            bool expected = false;
+            if (publisher.slots[i].used.compare_exchange_strong(expected, true)) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot < 0)
+            std::this_thread::yield();
+    }
+    // Annonce de l'époque puis lecture du pointeur (dans cet ordre : voir reclaim)
+    publisher.slots[slot].epoch.store(publisher.epoch.load());
+    snapshot = publisher.current.load();
+}
+
+SnapshotPublisher::Reader::~Reader() {
+    publisher.slots[slot].epoch.store(0);
+    publisher.slots[slot].used.store(false);
+}
+
+SnapshotPublisher::SnapshotPublisher() : epoch(1), current(nullptr), latest(0), version(0) {
+    for (int i = 0; i < MAX_READERS; i++) {
+        slots[i].epoch.store(0);
+        slots[i].used.store(false);
+    }
+    Snapshot *empty = new Snapshot();
+    empty->version = empty->stateVersion = empty->baseVersion = 0;
+    empty->settings = SimulationSettings();
+    empty->info = std::make_shared<const std::vector<ParticleInfo> >();
+    empty->state = std::make_shared<const HistoryFrame>();
+    empty->history = std::make_shared<const HistoryView>();
+    empty->frameVersions = std::make_shared<const std::vector<uint64_t> >();
+    empty->cache = std::make_shared<SnapshotCache>();
+    current.store(empty);
+}
+
+SnapshotPublisher::~SnapshotPublisher() {
+    for (auto &r : retired)
+        delete r.second;
+    delete current.load();
+}
+
+std::shared_ptr<const std::vector<ParticleInfo> > SnapshotPublisher::makeInfo(const std::vector<Particle> &particles) const {
+    std::shared_ptr<std::vector<ParticleInfo> > result = std::make_shared<std::vector<ParticleInfo> >();
+    result->reserve(particles.size());
+    for (const auto &p : particles)
+        result->push_back({p.getId(), p.getName(), p.getMass(), p.getMasseVolumique(), p.getColorHex()});
+    return result;
+}
+
+std::shared_ptr<const HistoryFrame> SnapshotPublisher::makeState(const std::vector<Particle> &particles) const {
+    std::shared_ptr<HistoryFrame> frame = std::make_shared<HistoryFrame>();
+    std::size_t n = particles.size();
+    frame->x.resize(n); frame->y.resize(n); frame->z.resize(n);
+    frame->vx.resize(n); frame->vy.resize(n); frame->vz.resize(n);
+    for (std::size_t i = 0; i < n; i++) {
+        Vector3D v = particles[i].getVelocity();
+        frame->x[i] = particles[i].x();
+        frame->y[i] = particles[i].y();
+        frame->z[i] = particles[i].z();
+        frame->vx[i] = v.x;
+        frame->vy[i] = v.y;
+        frame->vz[i] = v.z;
+    }
+    return frame;
+}
+
+// Publie la fin d'un pas : l'état courant est la dernière trame de l'historique (sans recopie)
+void SnapshotPublisher::publishStep(const std::vector<Particle> &particles, const SimulationSettings &settings, const HistoryBuffer &history) {
+    std::lock_guard<std::mutex> lock(writerMtx);
+    Snapshot *snapshot = new Snapshot();
+    snapshot->settings = settings;
+    snapshot->history = history.view();
+    if (!snapshot->history->empty() && snapshot->history->back()->size() == particles.size())
+        snapshot->state = snapshot->history->back();
+    else
+        snapshot->state = makeState(particles);
+    // Les attributs constants ne sont reconstruits que si l'ensemble des particules a changé
+    if (!info || info->size() != particles.size())
+        info = makeInfo(particles);
+    snapshot->info = info;
+    snapshot->stateVersion = version + 1;
+    snapshot->baseVersion = current.load()->baseVersion;
+    stampFrames(snapshot);
+    publish(snapshot);
+}
+
+// Publie l'état courant des particules (après une modification par l'API)
+void SnapshotPublisher::publishParticles(const std::vector<Particle> &particles, const SimulationSettings &settings, const HistoryBuffer &history) {
+    std::lock_guard<std::mutex> lock(writerMtx);
+    Snapshot *snapshot = new Snapshot();
+    snapshot->settings = settings;
+    snapshot->history = history.view();
+    snapshot->state = makeState(particles);
+    info = makeInfo(particles);
+    snapshot->info = info;
+    snapshot->stateVersion = snapshot->baseVersion = version + 1;
+    stampFrames(snapshot);
+    publish(snapshot);
+}
+
+// Publie de nouveaux paramètres en gardant l'état des particules
+void SnapshotPublisher::publishSettings(const SimulationSettings &settings) {
+    std::lock_guard<std::mutex> lock(writerMtx);
+    const Snapshot *previous = current.load();
+    Snapshot *snapshot = new Snapshot(*previous);
+    snapshot->settings = settings;
+    publish(snapshot);
+}
+
+// Versions des trames : la fenêtre ne fait que perdre des trames en tête et en gagner en queue,
+// les trames déjà publiées se retrouvent donc dans le même ordre dans l'instantané courant
+void SnapshotPublisher::stampFrames(Snapshot *snapshot) const {
+    const Snapshot *previous = current.load();
+    const HistoryView &old = *previous->history;
+    std::shared_ptr<std::vector<uint64_t> > versions = std::make_shared<std::vector<uint64_t> >();
+    versions->reserve(snapshot->history->size());
+    std::size_t k = 0;
+    for (const auto &frame : *snapshot->history) {
+        while (k < old.size() && old[k] != frame)
+            k++;
+        versions->push_back(k < old.size() ? (*previous->frameVersions)[k] : version + 1);
+    }
+    snapshot->frameVersions = versions;
+}
+
+// Remplace l'instantané courant et libère ceux qu'aucun lecteur ne peut plus voir (writerMtx tenu)
+void SnapshotPublisher::publish(Snapshot *snapshot) {
+    snapshot->version = ++version;
+    snapshot->cache = std::make_shared<SnapshotCache>();
+    const Snapshot *old = current.exchange(snapshot);
+    {
+        std::lock_guard<std::mutex> lock(updateMtx);
+        latest.store(version);
+    }
+    updated.notify_all();
+    // Un lecteur qui a pu lire old a annoncé une époque <= retiredAt
+    uint64_t retiredAt = epoch.fetch_add(1);
+    retired.push_back(std::make_pair(retiredAt, old));
+    reclaim();
+}
+
+// Attend une publication de version > after pendant au plus timeout ; renvoie la version courante
+uint64_t SnapshotPublisher::waitForUpdate(uint64_t after, std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(updateMtx);
+    updated.wait_for(lock, timeout, [this, after]() { return latest.load() > after; });
+    return latest.load();
+}
+
+void SnapshotPublisher::reclaim() {
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (int i = 0; i < MAX_READERS; i++) {
+        uint64_t e = slots[i].epoch.load();
+        if (e != 0)
+            oldest = std::min(oldest, e);
+    }
+    auto stillVisible = std::partition(retired.begin(), retired.end(),
+                                       [oldest](const std::pair<uint64_t, const Snapshot*> &r) { return r.first >= oldest; });
+    for (auto it = stillVisible; it != retired.end(); ++it)
+        delete it->second;
+    retired.erase(stillVisible, retired.end());
+}
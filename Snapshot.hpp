@@ -0,0 +1,132 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <cstdint>
+
+#include "Particle.hpp"
+#include "HistoryBuffer.hpp"
+#include "Octree.hpp"
+#include "SimulationSettings.hpp"
+
+// Attributs des particules qui ne changent pas d'un pas à l'autre
+struct ParticleInfo {
+    int id;
+    std::string name;
+    float mass;
+    float masseVolumique;
+    std::string colorHex;
+};
+
+// Encodages d'un instantané (message du flux, corps de réponse), calculés une seule fois à la demande
+// et partagés par tous les lecteurs de cet instantané
+class SnapshotCache {
+public:
+    std::shared_ptr<const std::string> get(const std::string &key, const std::function<std::string()> &encode);
+    // Octree des positions publiées (state) et des masses (info), construit au premier appel :
+    // requêtes spatiales (topologie seule) et niveau de détail (moments, calculés à la première demande)
+    std::shared_ptr<const Octree> tree(const HistoryFrame &state, const std::vector<ParticleInfo> &info, bool moments = false);
+private:
+    // Capacité des feuilles de l'octree des requêtes
+    static const int TREE_CAPACITY = 16;
+    // Au-delà, les encodages sont renvoyés sans être gardés (instantané conservé longtemps, en pause)
+    static const std::size_t MAX_ENTRIES = 64;
+    static const std::size_t MAX_BYTES = std::size_t(128) << 20;
+
+    std::mutex mtx; // Tenu pendant l'encodage : les lecteurs concurrents attendent le résultat
+    std::map<std::string, std::shared_ptr<const std::string> > entries;
+    std::size_t bytes = 0; // Taille totale des encodages gardés
+    std::mutex treeMtx;
+    std::shared_ptr<Octree> index;
+    bool indexMoments = false;
+};
+
+// État publié de la simulation, immuable : les lecteurs n'y accèdent qu'en lecture
+struct Snapshot {
+    uint64_t version;                                         // Numéro de publication (croissant)
+    uint64_t stateVersion;                                    // Dernière publication qui a changé les particules (pas ou API)
+    uint64_t baseVersion;                                     // Dernière discontinuité (chargement, rembobinage, reset) :
+                                                              // un client antérieur doit relire l'état complet
+    SimulationSettings settings;                              // Paramètres au moment de la publication
+    std::shared_ptr<const std::vector<ParticleInfo> > info;   // Attributs constants des particules
+    std::shared_ptr<const HistoryFrame> state;                // Positions et vitesses publiées
+    std::shared_ptr<const HistoryView> history;               // Trajectoires (fenêtre de l'historique)
+    std::shared_ptr<const std::vector<uint64_t> > frameVersions; // Publication qui a ajouté chaque trame de history
+    std::shared_ptr<SnapshotCache> cache;                     // Propre à cette publication
+};
+
+// Publication RCU de l'état de la simulation
+//
+// Chaque publication remplace le pointeur atomique vers l'instantané courant. Un lecteur annonce l'époque
+// globale dans un emplacement réservé avant de lire le pointeur ; l'ancien instantané n'est libéré que
+// lorsque plus aucun lecteur n'a annoncé une époque antérieure à son retrait (récupération par époques).
+// Les lecteurs ne prennent aucun verrou et ne bloquent jamais la simulation.
+class SnapshotPublisher {
+public:
+    // Accès en lecture à l'instantané courant, valide pendant la durée de vie du Reader
+    class Reader {
+    public:
+        explicit Reader(const SnapshotPublisher &publisher);
+        ~Reader();
+        const Snapshot& operator*() const { return *snapshot; }
+        const Snapshot* operator->() const { return snapshot; }
+    private:
+        Reader(const Reader&);
+        Reader& operator=(const Reader&);
+        const SnapshotPublisher &publisher;
+        int slot;
+        const Snapshot *snapshot;
+    };
+
+    SnapshotPublisher();
+    ~SnapshotPublisher();
+
+    // Publie la fin d'un pas : l'état courant est la dernière trame de l'historique (sans recopie)
+    void publishStep(const std::vector<Particle> &particles, const SimulationSettings &settings, const HistoryBuffer &history);
+    // Publie l'état courant des particules (après une modification par l'API)
+    void publishParticles(const std::vector<Particle> &particles, const SimulationSettings &settings, const HistoryBuffer &history);
+    // Publie de nouveaux paramètres en gardant l'état des particules
+    void publishSettings(const SimulationSettings &settings);
+    // Attend une publication de version > after pendant au plus timeout ; renvoie la version courante
+    uint64_t waitForUpdate(uint64_t after, std::chrono::milliseconds timeout) const;
+
+private:
+    static const int MAX_READERS = 64;
+
+    // Emplacement d'un lecteur : époque annoncée (0 : inactif), sur sa propre ligne de cache
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> epoch;
+        std::atomic<bool> used;
+    };
+
+    mutable ReaderSlot slots[MAX_READERS];
+    std::atomic<uint64_t> epoch;
+    std::atomic<const Snapshot*> current;
+    std::atomic<uint64_t> latest;                 // Version de current, pour les lecteurs en attente
+    mutable std::mutex updateMtx;
+    mutable std::condition_variable updated;      // Notifié à chaque publication
+
+    std::mutex writerMtx; // Les écrivains (simulation, API) se synchronisent entre eux
+    std::vector<std::pair<uint64_t, const Snapshot*> > retired;
+    std::shared_ptr<const std::vector<ParticleInfo> > info;
+    uint64_t version;
+
+    std::shared_ptr<const std::vector<ParticleInfo> > makeInfo(const std::vector<Particle> &particles) const;
+    std::shared_ptr<const HistoryFrame> makeState(const std::vector<Particle> &particles) const;
+    // Versions des trames de snapshot->history : celles de l'instantané courant pour les trames déjà publiées,
+    // la prochaine version pour les nouvelles (writerMtx tenu)
+    void stampFrames(Snapshot *snapshot) const;
+    // Remplace l'instantané courant et libère ceux qu'aucun lecteur ne peut plus voir (writerMtx tenu)
+    void publish(Snapshot *snapshot);
+    void reclaim();
+};
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,42 @@
+#include "StepPipeline.hpp"
+
+#include <cstdio>
+
+StepPipeline::StepPipeline(TaskPool &pool) : graph(pool), pending(false) {}
+
+// Exécute un pas ; son historique et sa publication restent en attente
+void StepPipeline::run(const Phases &phases) {
+    graph.clear();
+    int history = -1;
+    if (pending) {
+        history = graph.add("history", pendingHistory);
+        graph.add("publish", pendingPublish, {history});
+    }
+    int bounds = graph.add("bounds", phases.bounds);
+    int build = graph.add("build", phases.build, {bounds});
+    int moments = graph.add("moments", phases.moments, {build});
+    int force = graph.add("force", phases.force, {moments});
+    graph.add("integrate", phases.integrate, {force, history});
+    graph.run();
+
+    pendingHistory = phases.history;
+    pendingPublish = phases.publish;
+    pending = true;
+}
+
+// Termine l'historique et la publication en attente (pause, fin de simulation)
+void StepPipeline::flush() {
+    if (!pending)
+        return;
+    pending = false;
+    pendingHistory();
+    pendingPublish();
+}
+
+bool StepPipeline::hasPending() const { return pending; }
+
+// Affiche la chronologie (début - fin en ms) des nœuds du dernier pas
+void StepPipeline::printTimeline() const {
+    for (int i = 0; i < graph.size(); i++)
+        printf("  %-10s %8.2f - %8.2f ms\n", graph.name(i).c_str(), graph.startMs(i), graph.endMs(i));
+}
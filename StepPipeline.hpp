@@ -0,0 +1,38 @@
+#ifndef STEPPIPELINE_H
+#define STEPPIPELINE_H
+
+#include <functional>
+
+#include "TaskPool.hpp"
+#include "TaskGraph.hpp"
+
+// Pas de simulation exprimé en graphe de tâches
+//
+//   bounds -> build -> moments -> force -> integrate          (chemin critique du pas n)
+//   history(n - 1) -> publish(n - 1)                          (en parallèle de bounds .. force du pas n)
+//
+// L'historique et la publication d'un pas sont différés au pas suivant : ils ne lisent que les positions,
+// que seul integrate modifie (integrate(n) attend history(n - 1)). flush() les termine quand aucun pas ne suit.
+class StepPipeline {
+public:
+    struct Phases {
+        std::function<void()> bounds, build, moments, force, integrate, history, publish;
+    };
+
+    explicit StepPipeline(TaskPool &pool);
+
+    // Exécute un pas ; son historique et sa publication restent en attente
+    void run(const Phases &phases);
+    // Termine l'historique et la publication en attente (pause, fin de simulation)
+    void flush();
+    bool hasPending() const;
+    // Affiche la chronologie (début - fin en ms) des nœuds du dernier pas
+    void printTimeline() const;
+
+private:
+    TaskGraph graph;
+    std::function<void()> pendingHistory, pendingPublish;
+    bool pending;
+};
+
+#endif // STEPPIPELINE_H
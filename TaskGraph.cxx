@@ -0,0 +1,57 @@
+#include "TaskGraph.hpp"
+
+#include <omp.h>
+
+TaskGraph::TaskGraph(TaskPool &pool) : pool(pool), origin(0.) {}
+
+// Ajoute un nœud exécuté après ses dépendances (identifiants déjà ajoutés), renvoie son identifiant
+int TaskGraph::add(const std::string &name, std::function<void()> task, std::initializer_list<int> dependencies) {
+    int id = static_cast<int>(nodes.size());
+    std::unique_ptr<Node> node(new Node());
+    node->name = name;
+    node->task = std::move(task);
+    node->nbDependencies = 0;
+    node->start = node->end = 0.;
+    for (int d : dependencies) {
+        if (d < 0 || d >= id)
+            continue;
+        nodes[d]->successors.push_back(id);
+        node->nbDependencies++;
+    }
+    nodes.push_back(std::move(node));
+    return id;
+}
+
+// Exécute le graphe complet et attend la fin de tous les nœuds
+void TaskGraph::run() {
+    for (auto &node : nodes)
+        node->remaining = node->nbDependencies;
+    origin = omp_get_wtime();
+    TaskGroup group;
+    for (int i = 0; i < size(); i++) {
+        if (nodes[i]->nbDependencies == 0)
+            launch(i, group);
+    }
+    pool.wait(group);
+}
+
+// Lance le nœud puis, à sa fin, les successeurs dont c'était la dernière dépendance
+void TaskGraph::launch(int id, TaskGroup &group) {
+    pool.spawn(group, [this, id, &group]() {
+        Node &node = *nodes[id];
+        node.start = (omp_get_wtime() - origin) * 1e3;
+        node.task();
+        node.end = (omp_get_wtime() - origin) * 1e3;
+        for (int s : node.successors) {
+            if (--nodes[s]->remaining == 0)
+                launch(s, group);
+        }
+    });
+}
+
+void TaskGraph::clear() { nodes.clear(); }
+
+int TaskGraph::size() const { return static_cast<int>(nodes.size()); }
+const std::string& TaskGraph::name(int node) const { return nodes[node]->name; }
+double TaskGraph::startMs(int node) const { return nodes[node]->start; }
+double TaskGraph::endMs(int node) const { return nodes[node]->end; }
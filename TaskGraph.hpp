@@ -0,0 +1,49 @@
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <initializer_list>
+
+#include "TaskPool.hpp"
+
+// Graphe de tâches avec dépendances explicites, exécuté sur le pool à vol de travail
+// Un nœud est lancé dès que toutes ses dépendances sont terminées ; les nœuds indépendants se recouvrent.
+class TaskGraph {
+public:
+    explicit TaskGraph(TaskPool &pool);
+
+    // Ajoute un nœud exécuté après ses dépendances (identifiants déjà ajoutés), renvoie son identifiant
+    int add(const std::string &name, std::function<void()> task, std::initializer_list<int> dependencies = {});
+    // Exécute le graphe complet et attend la fin de tous les nœuds
+    void run();
+    // Retire tous les nœuds
+    void clear();
+
+    int size() const;
+    const std::string& name(int node) const;
+    // Début et fin (ms depuis le lancement de run) du dernier passage d'un nœud
+    double startMs(int node) const;
+    double endMs(int node) const;
+
+private:
+    struct Node {
+        std::string name;
+        std::function<void()> task;
+        std::vector<int> successors;
+        int nbDependencies;
+        std::atomic<int> remaining;
+        double start, end;
+    };
+
+    TaskPool &pool;
+    std::vector<std::unique_ptr<Node> > nodes;
+    double origin;
+
+    void launch(int node, TaskGroup &group);
+};
+
+#endif // TASKGRAPH_H
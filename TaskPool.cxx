@@ -0,0 +1,189 @@
+#include "TaskPool.hpp"
+
+#include <algorithm>
+
+#include <omp.h>
+
+// Indice du participant pour le thread courant (-1 : thread extérieur au pool)
+static thread_local const TaskPool *currentPool = nullptr;
+static thread_local int currentWorker = -1;
+// Thread extérieur : groupes ouverts (spawn sans wait) et tâche du pool en cours d'exécution dans wait()
+static thread_local int externalGroups = 0;
+static thread_local int helping = 0;
+
+TaskPool::TaskPool(int nbThreads) : queued(0), sleepers(0), stopping(false), externalUsers(0), resizing(false) {
+    startThreads(nbThreads, std::function<void(int)>());
+}
+
+TaskPool::~TaskPool() {
+    stopThreads();
+}
+
+void TaskPool::startThreads(int nbThreads, std::function<void(int)> onStart) {
+    nbThreads = std::max(1, nbThreads);
+    stopping = false;
+    for (int i = 0; i < nbThreads; i++)
+        workers.push_back(new Worker());
+    for (int i = 1; i < nbThreads; i++)
+        threads.push_back(std::thread([this, i, onStart]() {
+            if (onStart)
+                onStart(i);
+            workerLoop(i);
+        }));
+    if (onStart)
+        onStart(0);
+}
+
+void TaskPool::stopThreads() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMtx);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto &t : threads)
+        t.join();
+    threads.clear();
+    for (Worker *w : workers)
+        delete w;
+    workers.clear();
+}
+
+// Redimensionne le pool (threads de fond arrêtés puis relancés), une fois les groupes extérieurs terminés
+void TaskPool::configure(int nbThreads, std::function<void(int)> onStart) {
+    {
+        std::unique_lock<std::mutex> lock(gateMtx);
+        resizing = true;
+        gateOpen.wait(lock, [this]() { return externalUsers == 0; });
+    }
+    // Plus aucun groupe ouvert : toutes les tâches sont terminées, les deques peuvent être recréées
+    stopThreads();
+    startThreads(nbThreads, onStart);
+    {
+        std::lock_guard<std::mutex> lock(gateMtx);
+        resizing = false;
+    }
+    gateOpen.notify_all();
+}
+
+void TaskPool::enterExternal() {
+    if (externalGroups++ > 0)
+        return;
+    std::unique_lock<std::mutex> lock(gateMtx);
+    gateOpen.wait(lock, [this]() { return !resizing; });
+    externalUsers++;
+}
+
+void TaskPool::leaveExternal() {
+    if (--externalGroups > 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(gateMtx);
+        externalUsers--;
+    }
+    gateOpen.notify_all();
+}
+
+// Pool partagé par les solveurs, dimensionné sur omp_get_max_threads() au premier appel
+TaskPool& TaskPool::global() {
+    static TaskPool pool(omp_get_max_threads());
+    return pool;
+}
+
+int TaskPool::threadCount() const { return static_cast<int>(workers.size()); }
+
+int TaskPool::currentIndex() const {
+    return (currentPool == this) ? currentWorker : 0;
+}
+
+// Lance une tâche rattachée au groupe
+void TaskPool::spawn(TaskGroup &group, std::function<void()> task) {
+    // Premier spawn d'un thread extérieur sur ce groupe (hors tâche du pool) : accès tenu jusqu'à wait()
+    if (currentPool != this && helping == 0 && !group.external) {
+        enterExternal();
+        group.external = true;
+    }
+    group.pending++;
+    Worker &w = *workers[currentIndex()];
+    {
+        std::lock_guard<std::mutex> lock(w.mtx);
+        w.tasks.push_back([&group, task]() {
+            task();
+            group.pending--;
+        });
+    }
+    queued++;
+    // Réveil d'un thread endormi (sleepers est relu après l'incrément de queued : pas de réveil perdu)
+    if (sleepers > 0) {
+        std::lock_guard<std::mutex> lock(sleepMtx);
+        wakeUp.notify_one();
+    }
+}
+
+// Prend une tâche (deque locale par l'arrière, sinon vol par l'avant) ; faux si aucune
+bool TaskPool::takeTask(int self, std::function<void()> &task) {
+    if (queued.load() == 0)
+        return false;
+    {
+        Worker &w = *workers[self];
+        std::lock_guard<std::mutex> lock(w.mtx);
+        if (!w.tasks.empty()) {
+            task = std::move(w.tasks.back());
+            w.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    int n = static_cast<int>(workers.size());
+    for (int k = 1; k < n; k++) {
+        Worker &victim = *workers[(self + k) % n];
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Attend la fin des tâches du groupe en exécutant des tâches disponibles
+void TaskPool::wait(TaskGroup &group) {
+    int self = currentIndex();
+    bool external = currentPool != this;
+    std::function<void()> task;
+    while (group.pending.load() > 0) {
+        if (takeTask(self, task)) {
+            // Les groupes ouverts par cette tâche sont couverts par l'accès déjà tenu par ce thread
+            if (external)
+                helping++;
+            task();
+            if (external)
+                helping--;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    if (group.external) {
+        group.external = false;
+        leaveExternal();
+    }
+}
+
+void TaskPool::workerLoop(int index) {
+    currentPool = this;
+    currentWorker = index;
+    std::function<void()> task;
+    while (true) {
+        if (takeTask(index, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMtx);
+        sleepers++;
+        wakeUp.wait(lock, [this]() { return queued.load() > 0 || stopping.load(); });
+        sleepers--;
+        if (stopping)
+            return;
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+// Groupe de tâches : compteur des tâches lancées et non terminées
+struct TaskGroup {
+    std::atomic<int> pending;
+    bool external; // Ouvert par un thread extérieur au pool : il tient l'accès au pool jusqu'à son wait()
+    TaskGroup() : pending(0), external(false) {}
+};
+
+// Ordonnanceur de tâches à vol de travail (work stealing)
+//
+// Chaque thread du pool possède sa deque : il empile et dépile ses tâches par l'arrière (ordre LIFO,
+// localité du sous-arbre en cours) ; un thread sans travail vole par l'avant chez un autre (les plus grosses
+// tâches, créées en premier). Les threads extérieurs au pool (thread principal) partagent la deque 0.
+// wait() exécute d'autres tâches en attendant la fin du groupe ; les threads inactifs dorment.
+// Un thread extérieur tient l'accès au pool de son premier spawn() sur un groupe jusqu'au wait() de
+// ce groupe : configure() attend que plus aucun thread extérieur ne le tienne avant de recréer les deques.
+class TaskPool {
+public:
+    // nbThreads participants, dont le thread appelant (nbThreads - 1 threads de fond)
+    explicit TaskPool(int nbThreads);
+    ~TaskPool();
+
+    // Pool partagé par les solveurs, dimensionné sur omp_get_max_threads() au premier appel
+    static TaskPool& global();
+
+    int threadCount() const;
+    // Redimensionne le pool (threads de fond arrêtés puis relancés) ; onStart(i) est appelé au démarrage
+    // de chaque participant, dans son thread (0 : l'appelant). Attend la fin des groupes ouverts par les
+    // threads extérieurs et bloque les nouveaux ; l'appelant ne doit lui-même avoir aucun groupe ouvert.
+    void configure(int nbThreads, std::function<void(int)> onStart);
+    // Lance une tâche rattachée au groupe
+    void spawn(TaskGroup &group, std::function<void()> task);
+    // Attend la fin des tâches du groupe en exécutant des tâches disponibles
+    void wait(TaskGroup &group);
+
+    // Applique f(i) pour i dans [begin, end) en tâches d'au plus grain itérations (découpage récursif)
+    template <typename F>
+    void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, const F &f) {
+        TaskGroup group;
+        forRange(group, begin, end, grain < 1 ? 1 : grain, f);
+        wait(group);
+    }
+
+private:
+    struct Worker {
+        std::mutex mtx;
+        std::deque<std::function<void()> > tasks;
+    };
+
+    std::vector<Worker*> workers;    // Une deque par participant
+    std::vector<std::thread> threads;
+    std::atomic<int> queued;         // Tâches en attente dans l'ensemble des deques
+    std::atomic<int> sleepers;
+    std::atomic<bool> stopping;
+    std::mutex sleepMtx;
+    std::condition_variable wakeUp;
+    std::mutex gateMtx;
+    std::condition_variable gateOpen;
+    int externalUsers;               // Threads extérieurs ayant au moins un groupe ouvert (gateMtx)
+    bool resizing;                   // configure() en cours : nouveaux groupes extérieurs en attente (gateMtx)
+
+    int currentIndex() const;
+    void startThreads(int nbThreads, std::function<void(int)> onStart);
+    void stopThreads();
+    // Accès d'un thread extérieur au pool, réentrant (compté par thread)
+    void enterExternal();
+    void leaveExternal();
+    // Prend une tâche (deque locale par l'arrière, sinon vol par l'avant) ; faux si aucune
+    bool takeTask(int self, std::function<void()> &task);
+    void workerLoop(int index);
+
+    template <typename F>
+    void forRange(TaskGroup &group, std::size_t begin, std::size_t end, std::size_t grain, const F &f) {
+        while (end - begin > grain) {
+            std::size_t mid = begin + (end - begin) / 2;
+            spawn(group, [this, &group, mid, end, grain, &f]() { forRange(group, mid, end, grain, f); });
+            end = mid;
+        }
+        for (std::size_t i = begin; i < end; i++)
+            f(i);
+    }
+};
+
+#endif // TASKPOOL_H
@@ -0,0 +1,211 @@
+#include "ThreadTopology.hpp"
+#include "TaskPool.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+#include <omp.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// Lit un entier de /sys/devices/system/cpu/cpuN/topology (0 si absent)
+static int readTopology(int cpu, const char *field) {
+    std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + field);
+    int value = 0;
+    if (!(in >> value))
+        return 0;
+    return value;
+}
+
+// Épingle le thread appelant sur les cœurs donnés
+static void pinCurrentThread(const std::vector<int> &cpus) {
+#ifdef __linux__
+    if (cpus.empty())
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+        CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)cpus;
+#endif
+}
+
+ThreadTopology::ThreadTopology() : placement("none"), available(availableCpus()) {
+    update();
+}
+
+// Cœurs autorisés pour le processus
+std::vector<int> ThreadTopology::availableCpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+    }
+#endif
+    if (cpus.empty()) {
+        int n = std::max(1, omp_get_num_procs());
+        for (int cpu = 0; cpu < n; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+// "0,2,4-7" -> {0, 2, 4, 5, 6, 7}
+std::vector<int> ThreadTopology::parseCpuList(const std::string &list) {
+    std::vector<int> cpus;
+    std::stringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (item.empty())
+            continue;
+        std::size_t dash = item.find('-');
+        std::size_t end = 0;
+        try {
+            std::string head = item.substr(0, dash);
+            int first = std::stoi(head, &end);
+            if (end != head.size())
+                throw std::invalid_argument(item);
+            int last = first;
+            if (dash != std::string::npos) {
+                std::string tail = item.substr(dash + 1);
+                last = std::stoi(tail, &end);
+                if (end != tail.size())
+                    throw std::invalid_argument(item);
+            }
+            if (first < 0 || last < first)
+                throw std::invalid_argument(item);
+            for (int cpu = first; cpu <= last; cpu++)
+                cpus.push_back(cpu);
+        } catch (const std::logic_error &) {
+            throw std::invalid_argument("liste de cœurs invalide : " + list);
+        }
+    }
+    return cpus;
+}
+
+void ThreadTopology::setAffinity(const std::string &affinity) {
+    if (affinity != "none" && affinity != "compact" && affinity != "scatter") {
+        std::vector<int> cpus = parseCpuList(affinity);
+        for (int cpu : cpus)
+            if (std::find(available.begin(), available.end(), cpu) == available.end())
+                throw std::invalid_argument("cœur " + std::to_string(cpu) + " non disponible");
+        if (cpus.empty())
+            throw std::invalid_argument("placement invalide : " + affinity);
+    }
+    std::string previous = placement;
+    placement = affinity;
+    try {
+        update();
+    } catch (...) {
+        placement = previous;
+        update();
+        throw;
+    }
+}
+
+void ThreadTopology::setApiCores(const std::string &cores) {
+    std::vector<int> cpus = parseCpuList(cores);
+    for (int cpu : cpus)
+        if (std::find(available.begin(), available.end(), cpu) == available.end())
+            throw std::invalid_argument("cœur " + std::to_string(cpu) + " non disponible");
+    std::vector<int> previous = api;
+    api = cpus;
+    try {
+        update();
+    } catch (...) {
+        api = previous;
+        update();
+        throw;
+    }
+}
+
+// Ordre d'attribution des cœurs de la simulation selon le placement
+void ThreadTopology::update() {
+    if (placement != "none" && placement != "compact" && placement != "scatter") {
+        std::vector<int> cpus = parseCpuList(placement);
+        for (int cpu : cpus)
+            if (std::find(api.begin(), api.end(), cpu) != api.end())
+                throw std::invalid_argument("cœur " + std::to_string(cpu) + " réservé à l'API");
+        simulation = cpus;
+        return;
+    }
+
+    // (socket, cœur physique, cpu) des cœurs non réservés à l'API, dans l'ordre compact :
+    // hyperthreads d'un même cœur, puis cœurs voisins du même socket
+    typedef std::tuple<int, int, int> Slot;
+    std::vector<Slot> slots;
+    for (int cpu : available)
+        if (std::find(api.begin(), api.end(), cpu) == api.end())
+            slots.push_back(Slot(readTopology(cpu, "physical_package_id"), readTopology(cpu, "core_id"), cpu));
+    if (slots.empty())
+        throw std::invalid_argument("aucun cœur disponible pour la simulation");
+    std::sort(slots.begin(), slots.end());
+
+    simulation.clear();
+    if (placement == "scatter") {
+        // Un thread par cœur physique avant les hyperthreads, en alternant les sockets :
+        // tri sur (rang de l'hyperthread dans le cœur, rang du cœur dans le socket, socket)
+        typedef std::tuple<int, int, int, int> Rank;
+        std::vector<Rank> order;
+        int thread = 0, core = 0;
+        for (std::size_t i = 0; i < slots.size(); i++) {
+            if (i > 0) {
+                bool samePackage = std::get<0>(slots[i]) == std::get<0>(slots[i - 1]);
+                bool sameCore = samePackage && std::get<1>(slots[i]) == std::get<1>(slots[i - 1]);
+                thread = sameCore ? thread + 1 : 0;
+                core = !samePackage ? 0 : (sameCore ? core : core + 1);
+            }
+            order.push_back(Rank(thread, core, std::get<0>(slots[i]), std::get<2>(slots[i])));
+        }
+        std::sort(order.begin(), order.end());
+        for (const Rank &r : order)
+            simulation.push_back(std::get<3>(r));
+    } else {
+        for (const Slot &s : slots)
+            simulation.push_back(std::get<2>(s));
+    }
+}
+
+const std::string& ThreadTopology::affinity() const { return placement; }
+const std::vector<int>& ThreadTopology::simulationCpus() const { return simulation; }
+const std::vector<int>& ThreadTopology::apiCpus() const { return api; }
+
+// Cœur attribué au i-ème thread de simulation (-1 : non épinglé)
+int ThreadTopology::cpuForThread(int index) const {
+    if (placement == "none" || simulation.empty())
+        return -1;
+    return simulation[index % simulation.size()];
+}
+
+void ThreadTopology::pinSimulationThread(int index) const {
+    int cpu = cpuForThread(index);
+    if (cpu >= 0)
+        pinCurrentThread(std::vector<int>(1, cpu));
+    else
+        // Sans placement : libre sur tous les cœurs de la simulation (hors cœurs de l'API)
+        pinCurrentThread(simulation);
+}
+
+void ThreadTopology::pinApiThread() const {
+    // Sans cœurs réservés : masque du processus au démarrage, et non celui du thread qui a lancé l'API
+    // (épinglé sur le cœur du thread de simulation 0 par apply())
+    pinCurrentThread(api.empty() ? available : api);
+}
+
+// Dimensionne le pool de tâches sur nbThreads et épingle ses threads (tous les solveurs passent par le pool :
+// aucune équipe OpenMP n'est créée pendant la simulation)
+void ThreadTopology::apply(int nbThreads) const {
+    nbThreads = std::max(1, nbThreads);
+    TaskPool::global().configure(nbThreads, [this](int index) { pinSimulationThread(index); });
+}
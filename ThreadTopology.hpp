@@ -0,0 +1,50 @@
+#ifndef THREADTOPOLOGY_HPP
+#define THREADTOPOLOGY_HPP
+
+#include <vector>
+#include <string>
+
+// Placement des threads de simulation et de l'API sur les cœurs
+//
+// Les cœurs réservés à l'API (et aux entrées/sorties) sont retirés de ceux de la simulation. Placements :
+//   none    : pas d'épinglage (les threads de simulation restent hors des cœurs de l'API s'il y en a)
+//   compact : threads consécutifs sur des cœurs voisins (même socket, puis hyperthreads du même cœur)
+//   scatter : threads répartis en alternance sur les sockets, un thread par cœur physique d'abord
+//   liste   : cœurs explicites, par ex. "0,2,4-7" (le thread i prend le i-ème cœur de la liste)
+// L'épinglage passe par sched_setaffinity sous Linux ; ailleurs il est sans effet.
+class ThreadTopology {
+public:
+    ThreadTopology();
+
+    // Lèvent std::invalid_argument si la description est invalide ou ne désigne aucun cœur disponible
+    void setAffinity(const std::string &affinity);
+    void setApiCores(const std::string &cores);
+
+    const std::string& affinity() const;
+    const std::vector<int>& simulationCpus() const;
+    const std::vector<int>& apiCpus() const;
+
+    // Dimensionne le pool de tâches sur nbThreads et épingle ses threads ;
+    // à appeler depuis le thread de simulation, sans tâche en cours
+    void apply(int nbThreads) const;
+    // Épingle le thread appelant : i-ème thread de simulation / thread de l'API
+    void pinSimulationThread(int index) const;
+    void pinApiThread() const;
+    // Cœur attribué au i-ème thread de simulation (-1 : non épinglé)
+    int cpuForThread(int index) const;
+
+    // Cœurs autorisés pour le processus
+    static std::vector<int> availableCpus();
+    // "0,2,4-7" -> {0, 2, 4, 5, 6, 7}
+    static std::vector<int> parseCpuList(const std::string &list);
+
+private:
+    std::string placement;
+    std::vector<int> available;
+    std::vector<int> api;
+    std::vector<int> simulation; // Dans l'ordre d'attribution aux threads
+
+    void update();
+};
+
+#endif // THREADTOPOLOGY_HPP
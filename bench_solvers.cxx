@@ -0,0 +1,238 @@
+// Banc d'essai des solveurs de gravité (Octree, KdTree, FMM) sur les scénarios de ceinture d'astéroïdes
+//
+// Charge un scénario JSON (même format que POST /particles), y ajoute éventuellement une ceinture
+// synthétique de N astéroïdes autour du premier corps, puis mesure pour chaque solveur :
+// temps de construction, temps du calcul des forces, nombre de nœuds et erreur relative
+// par rapport à la sommation directe sur un échantillon de particules.
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <limits>
+#include <chrono>
+
+#include <omp.h>
+
+#include <boost/program_options.hpp>
+#include <boost/random.hpp>
+
+#include "nlohmann/json.hpp"
+#include "Particle.hpp"
+#include "Octree.hpp"
+#include "KdTree.hpp"
+#include "FMMSolver.hpp"
+#include "InteractionCache.hpp"
+#include "Gravity.hpp"
+#include "MyRNG.hpp"
+
+using json = nlohmann::json;
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Charge un scénario au format de POST /particles
+static bool loadScenario(const std::string &path, std::vector<Particle> &particles) {
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    json j = json::parse(in);
+    for (const auto &jp : j) {
+        particles.push_back(Particle(jp.value("x", 0.f), jp.value("y", 0.f), jp.value("z", 0.f),
+                                     jp.value("vx", 0.f), jp.value("vy", 0.f), jp.value("vz", 0.f),
+                                     jp.value("mass", 1.f), jp.value("masseVolumique", 1.f), jp.value("colorHex", "")));
+    }
+    return true;
+}
+
+// Ceinture synthétique (mêmes lois que solar_generator/*asteriods_belt*.py)
+static void addBelt(std::vector<Particle> &particles, int n, float rMin, float rMax, unsigned seed) {
+    boost::random::mt19937 gen(seed);
+    boost::random::uniform_real_distribution<float> radius(rMin, rMax);
+    boost::random::uniform_real_distribution<float> angle(0.f, 2.f * static_cast<float>(M_PI));
+    boost::random::uniform_real_distribution<float> inclination(-0.05f, 0.05f);
+    boost::random::uniform_real_distribution<float> mass(0.1f, 1.f);
+    Vector3D center = particles.empty() ? Vector3D(500.f, 500.f, 500.f) : particles[0].getPosition();
+    for (int i = 0; i < n; i++) {
+        float r = radius(gen), a = angle(gen);
+        particles.push_back(Particle(center.x + r * std::cos(a), center.y + r * std::sin(a),
+                                     center.z + r * std::sin(inclination(gen)), 0.f, 0.f, 0.f, mass(gen)));
+    }
+}
+
+// Accélération exacte par sommation directe (double précision)
+static Vector3D directAcceleration(const std::vector<Particle> &particles, std::size_t i) {
+    double ax = 0., ay = 0., az = 0.;
+    Vector3D pi = particles[i].getPosition();
+    for (std::size_t j = 0; j < particles.size(); j++) {
+        if (j == i)
+            continue;
+        double dx = particles[j].x() - pi.x, dy = particles[j].y() - pi.y, dz = particles[j].z() - pi.z;
+        double d2 = dx * dx + dy * dy + dz * dz + epsilon_sq;
+        double f = G * particles[j].getMass() / (d2 * std::sqrt(d2));
+        ax += dx * f; ay += dy * f; az += dz * f;
+    }
+    return Vector3D(ax, ay, az);
+}
+
+struct BenchResult {
+    double buildMs, forceMs, meanErr, maxErr;
+    std::size_t nodes;
+};
+
+template <typename Tree>
+static BenchResult runBench(Tree &tree, const std::vector<Particle> &particles,
+                            const std::vector<std::size_t> &samples, const std::vector<Vector3D> &reference, int repeat) {
+    BenchResult r = {0., 0., 0., 0., 0};
+    std::vector<Vector3D> acc(particles.size());
+    for (int k = 0; k < repeat; k++) {
+        Clock::time_point t0 = Clock::now();
+        tree.build(particles);
+        r.buildMs += elapsedMs(t0);
+
+        t0 = Clock::now();
+        #pragma omp parallel for schedule(static)
+        for (std::size_t i = 0; i < particles.size(); i++) {
+            acc[i] = tree.computeAcceleration(particles[i]);
+        }
+        r.forceMs += elapsedMs(t0);
+    }
+    r.buildMs /= repeat;
+    r.forceMs /= repeat;
+    for (std::size_t s = 0; s < samples.size(); s++) {
+        Vector3D diff = acc[samples[s]] - reference[s];
+        double err = diff.norm() / std::max(reference[s].norm(), std::numeric_limits<float>::min());
+        r.meanErr += err;
+        r.maxErr = std::max(r.maxErr, err);
+    }
+    if (!samples.empty())
+        r.meanErr /= samples.size();
+    return r;
+}
+
+static void printResult(const std::string &name, const BenchResult &r) {
+    std::cout << std::left << std::setw(18) << name << std::right
+              << std::setw(10) << r.nodes
+              << std::setw(12) << std::fixed << std::setprecision(2) << r.buildMs
+              << std::setw(12) << r.forceMs
+              << std::setw(14) << std::scientific << std::setprecision(3) << r.meanErr
+              << std::setw(14) << r.maxErr << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    namespace po = boost::program_options;
+    std::string scenario;
+    int belt, nbSamples, repeat, octreeLeaf, kdLeaf, fmmLeaf;
+    float fmmTheta;
+    std::vector<int> fmmOrders;
+    po::options_description desc("Options autorisées");
+    desc.add_options()
+        ("help,h", "affiche ce message d'aide")
+        ("scenario", po::value<std::string>(&scenario)->default_value("system_stelar/solar_system_red_incl_aster_belt.json"), "scénario JSON (format de POST /particles)")
+        ("belt", po::value<int>(&belt)->default_value(50000), "nombre d'astéroïdes synthétiques ajoutés à la ceinture")
+        ("samples", po::value<int>(&nbSamples)->default_value(256), "nombre de particules comparées à la sommation directe")
+        ("repeat", po::value<int>(&repeat)->default_value(3), "nombre de répétitions de chaque mesure")
+        ("octree-leaf", po::value<int>(&octreeLeaf)->default_value(1), "nombre maximal de particules par feuille de l'octree")
+        ("kd-leaf", po::value<int>(&kdLeaf)->default_value(8), "nombre maximal de particules par feuille de l'arbre kd")
+        ("fmm-order", po::value<std::vector<int> >(&fmmOrders)->multitoken()->default_value(std::vector<int>{2, 4, 6}, "2 4 6"), "ordres des développements FMM à mesurer")
+        ("fmm-theta", po::value<float>(&fmmTheta)->default_value(0.7f), "critère d'ouverture de la traversée FMM")
+        ("fmm-leaf", po::value<int>(&fmmLeaf)->default_value(32), "nombre maximal de particules par feuille du FMM");
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        if (vm.count("help")) {
+            std::cout << desc << "\n";
+            return 0;
+        }
+        po::notify(vm);
+    }
+    catch (const po::error &ex) {
+        std::cerr << ex.what() << "\n";
+        return 1;
+    }
+
+    std::vector<Particle> particles;
+    if (!scenario.empty() && !loadScenario(scenario, particles)) {
+        std::cerr << "Impossible de lire le scénario " << scenario << "\n";
+        return 1;
+    }
+    addBelt(particles, belt, 180.f, 240.f, 42);
+    if (particles.empty())
+        return 0;
+
+    // Boîte cubique englobante (même construction que POST /particles)
+    float lo[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    float hi[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+    for (const auto &p : particles) {
+        lo[0] = std::min(lo[0], p.x()); hi[0] = std::max(hi[0], p.x());
+        lo[1] = std::min(lo[1], p.y()); hi[1] = std::max(hi[1], p.y());
+        lo[2] = std::min(lo[2], p.z()); hi[2] = std::max(hi[2], p.z());
+    }
+    float extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+    float cube = extent * 1.05f + 1e-3f;
+    float ox = 0.5f * (lo[0] + hi[0]) - 0.5f * cube;
+    float oy = 0.5f * (lo[1] + hi[1]) - 0.5f * cube;
+    float oz = 0.5f * (lo[2] + hi[2]) - 0.5f * cube;
+
+    // Référence par sommation directe sur un échantillon régulier
+    std::vector<std::size_t> samples;
+    std::size_t stride = std::max<std::size_t>(1, particles.size() / std::max(1, nbSamples));
+    for (std::size_t i = 0; i < particles.size() && samples.size() < static_cast<std::size_t>(nbSamples); i += stride)
+        samples.push_back(i);
+    std::vector<Vector3D> reference(samples.size());
+    #pragma omp parallel for
+    for (std::size_t s = 0; s < samples.size(); s++)
+        reference[s] = directAcceleration(particles, samples[s]);
+
+    std::cout << particles.size() << " particules, " << omp_get_max_threads() << " threads, theta = " << theta << "\n\n";
+    std::cout << std::left << std::setw(18) << "solveur" << std::right << std::setw(10) << "noeuds"
+              << std::setw(12) << "build (ms)" << std::setw(12) << "force (ms)"
+              << std::setw(14) << "err moy" << std::setw(14) << "err max" << std::endl;
+
+    Octree octree(ox, oy, oz, cube, cube, cube, octreeLeaf);
+    BenchResult r = runBench(octree, particles, samples, reference, repeat);
+    r.nodes = octree.nodeCount();
+    printResult("octree", r);
+
+    octree.setWideTraversal(true);
+    r = runBench(octree, particles, samples, reference, repeat);
+    r.nodes = octree.nodeCount();
+    printResult("octree (wide)", r);
+
+    // Listes d'interaction par groupe : construction complète à chaque pas puis réutilisation
+    // (le build inclut le calcul des forces ; en réutilisation, seuls les moments sont rafraîchis)
+    InteractionCache lists(0, 0.005f, 32, octreeLeaf);
+    r = runBench(lists, particles, samples, reference, repeat);
+    r.nodes = 0;
+    printResult("lists (rebuild)", r);
+
+    InteractionCache reused(1 << 30, 0.005f, 32, octreeLeaf);
+    reused.build(particles);
+    r = runBench(reused, particles, samples, reference, repeat);
+    r.nodes = 0;
+    printResult("lists (reuse)", r);
+
+    KdTree kdMedian(kdLeaf, KdTree::MEDIAN);
+    r = runBench(kdMedian, particles, samples, reference, repeat);
+    r.nodes = kdMedian.nodeCount();
+    printResult("kdtree (median)", r);
+
+    KdTree kdSah(kdLeaf, KdTree::SURFACE_AREA);
+    r = runBench(kdSah, particles, samples, reference, repeat);
+    r.nodes = kdSah.nodeCount();
+    printResult("kdtree (sah)", r);
+
+    // Pour le FMM, le build inclut tout le calcul des forces
+    for (int p : fmmOrders) {
+        FMMSolver fmm(p, fmmTheta, fmmLeaf);
+        r = runBench(fmm, particles, samples, reference, repeat);
+        r.nodes = 0;
+        printResult("fmm (p = " + std::to_string(fmm.getOrder()) + ")", r);
+    }
+
+    Octree::clearInstances();
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Études paramétriques : nombreuses simulations indépendantes dans un seul processus
+//
+// Lit un fichier JSON de membres ("defaults", "members", "sweep"), exécute tous les membres sur le pool
+// de tâches partagé (petits systèmes regroupés par lots, grands systèmes parallélisés) et écrit l'état
+// final de chaque membre ainsi qu'un résumé dans le répertoire de sortie.
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+
+#include <omp.h>
+
+#include <boost/program_options.hpp>
+
+#include "Ensemble.hpp"
+#include "TaskPool.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+int main(int argc, char *argv[]) {
+    namespace po = boost::program_options;
+    std::string scenarios, output;
+    int nbThreads, directBelow;
+    double batchCost;
+    po::options_description desc("Options autorisées");
+    desc.add_options()
+        ("help,h", "affiche ce message d'aide")
+        ("scenarios", po::value<std::string>(&scenarios)->required(), "fichier JSON des membres de l'ensemble")
+        ("output", po::value<std::string>(&output)->default_value("ensemble_out"), "répertoire des résultats")
+        ("threads", po::value<int>(&nbThreads)->default_value(0), "nombre de threads du pool (0 : tous les cœurs)")
+        ("direct-below", po::value<int>(&directBelow)->default_value(2048), "sommation directe jusqu'à ce nombre de particules")
+        ("batch-cost", po::value<double>(&batchCost)->default_value(5e8), "coût (interactions) en dessous duquel les membres sont regroupés par lots");
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        if (vm.count("help")) {
+            std::cout << desc << "\n";
+            return 0;
+        }
+        po::notify(vm);
+    }
+    catch (const po::error &ex) {
+        std::cerr << ex.what() << "\n";
+        return 1;
+    }
+
+    if (nbThreads > 0) {
+        omp_set_num_threads(nbThreads);
+        TaskPool::global().configure(nbThreads, std::function<void(int)>());
+    }
+
+    std::vector<EnsembleMember> members;
+    std::vector<EnsembleResult> results;
+    EnsembleRunner runner(TaskPool::global(), directBelow, batchCost);
+    Clock::time_point start = Clock::now();
+    try {
+        members = EnsembleRunner::load(scenarios);
+        results = runner.run(members, output);
+    }
+    catch (const std::exception &ex) {
+        std::cerr << ex.what() << "\n";
+        return 1;
+    }
+    double wall = std::chrono::duration<double>(Clock::now() - start).count();
+
+    double total = 0.;
+    std::cout << std::left << std::setw(40) << "membre" << std::right << std::setw(10) << "N" << std::setw(8) << "pas"
+              << std::setw(8) << "mode" << std::setw(12) << "durée (s)" << std::setw(16) << "E cinétique" << "\n";
+    for (const EnsembleResult &r : results) {
+        std::cout << std::left << std::setw(40) << r.name << std::right << std::setw(10) << r.particles << std::setw(8) << r.steps
+                  << std::setw(8) << (r.direct ? "direct" : "octree") << std::setw(12) << std::fixed << std::setprecision(3) << r.seconds
+                  << std::setw(16) << std::scientific << std::setprecision(4) << r.kinetic << std::defaultfloat << "\n";
+        total += r.seconds;
+    }
+    std::cout << members.size() << " membres en " << std::fixed << std::setprecision(3) << wall << " s (somme des membres : "
+              << total << " s), résultats dans " << output << "/\n";
+    return 0;
+}
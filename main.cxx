@@ -7,6 +7,7 @@
 #include <deque>
 #include <mutex>
 #include <atomic>
+#include <memory>
 
 #include <omp.h>
 
@@ -28,21 +29,124 @@
 // Inclusion de la structure Vector3D et Particle
 #include "Particle.hpp"
 #include "Octree.hpp"
+#include "Quadtree.hpp"
+#include "KdTree.hpp"
+#include "FMMSolver.hpp"
+#include "InteractionCache.hpp"
+#include "LoadBalancer.hpp"
+#include "TaskPool.hpp"
+#include "ThreadTopology.hpp"
+#include "StepPipeline.hpp"
+#include "HistoryBuffer.hpp"
+#include "Snapshot.hpp"
 #include "APIRest.hpp"
+#include "SimulationController.hpp"
+#include "Session.hpp"
+#ifdef USE_MPI
+#include "DistributedSimulation.hpp"
+#endif
 
 #include <boost/program_options.hpp>
 #include <boost/chrono.hpp>
 #include "MyRNG.hpp"
 
-// Mise à jour de l'état d'une particule en utilisant l'octree
-void updateParticleState(Particle &p, const Octree &tree, float dt) {
-    p.resetAcceleration();
-    p.addAcceleration(tree.computeAcceleration(p));
+// Taille des tâches des boucles sur les particules
+static const std::size_t PARTICLE_GRAIN = 1024;
+
+// Intégration 3D d'une particule (l'accélération est déjà calculée)
+template <typename Tree>
+void integrateParticle(Particle &p, const Tree &, float dt) {
     p.updateVelocity(dt);
     p.updatePosition(dt);
     p.checkBoundary();
 }
 
+// Intégration plane (mode 2D) d'une particule avec le quadtree
+void integrateParticle(Particle &p, const Quadtree &, float dt) {
+    p.updateVelocity2D(dt);
+    p.updatePosition2D(dt);
+    p.checkBoundary2D();
+}
+
+// Bornes de l'arbre : l'octree et le quadtree suivent la boîte courante (modifiable via l'API),
+// les autres solveurs calculent leur cube englobant au build
+template <typename Tree>
+void boundsPhase(Tree &) {}
+void boundsPhase(Octree &tree) { tree.updateAttributes(X_MIN, Y_MIN, Z_MIN, X_MAX - X_MIN, Y_MAX - Y_MIN, Z_MAX - Z_MIN, 1); }
+void boundsPhase(Quadtree &tree) { tree.updateAttributes(X_MIN, Y_MIN, X_MAX - X_MIN, Y_MAX - Y_MIN, 1); }
+
+// Construction : l'octree sépare topologie et moments, les autres solveurs font tout dans build()
+template <typename Tree>
+void buildPhase(Tree &tree, const std::vector<Particle> &particles) { tree.build(particles); }
+void buildPhase(Octree &tree, const std::vector<Particle> &particles) { tree.buildTopology(particles); }
+template <typename Tree>
+void momentsPhase(Tree &) {}
+void momentsPhase(Octree &tree) { tree.computeMoments(); }
+
+// État partagé par les phases d'un pas (particules, historique et publication vers l'API)
+struct SimulationState {
+    std::vector<Particle> &particles;
+    SimulationSettings &settings;
+    std::mutex &mtx;
+    HistoryBuffer &history;
+    SnapshotPublisher &snapshots;
+};
+
+// Phases d'un pas au temps time avec le solveur choisi (Octree, KdTree, FMM, listes ou Quadtree en 2D).
+// Le graphe les enchaîne (voir StepPipeline) ; history et publish recouvrent le pas suivant.
+template <typename Tree>
+StepPipeline::Phases stepPhases(Tree &tree, SimulationState &state, float time) {
+    std::vector<Particle> &particles = state.particles;
+    float dt = state.settings.dt;
+    float rewindMax = state.settings.rewind_max_history;
+    StepPipeline::Phases phases;
+    phases.bounds = [&tree]() { boundsPhase(tree); };
+    phases.build = [&tree, &particles]() { buildPhase(tree, particles); };
+    phases.moments = [&tree]() { momentsPhase(tree); };
+    phases.force = [&tree, &particles]() {
+        TaskPool::global().parallelFor(0, particles.size(), PARTICLE_GRAIN, [&](std::size_t i) {
+            particles[i].resetAcceleration();
+            particles[i].addAcceleration(tree.computeAcceleration(particles[i]));
+        });
+    };
+    phases.integrate = [&tree, &particles, dt]() {
+        TaskPool::global().parallelFor(0, particles.size(), PARTICLE_GRAIN, [&](std::size_t i) {
+            integrateParticle(particles[i], tree, dt);
+        });
+    };
+    // Une recopie en colonnes publiée atomiquement, sans verrou par particule
+    phases.history = [&state, time, rewindMax]() { state.history.record(state.particles, time, rewindMax); };
+    // Instantané de fin de pas pour l'API (l'état est la trame d'historique qui vient d'être enregistrée)
+    phases.publish = [&state, time, dt]() {
+        SimulationSettings published;
+        {
+            std::lock_guard<std::mutex> lock(state.mtx);
+            published = state.settings;
+        }
+        published.current_time = time + dt;
+        state.snapshots.publishStep(state.particles, published, state.history);
+    };
+    return phases;
+}
+
+// Force de l'octree avec découpage par coût (costzones) : chaque tâche traite un intervalle contigu
+// de l'ordre spatial dont le coût, estimé au pas précédent, est égal à celui des autres
+void balancedForce(Octree &tree, LoadBalancer &balancer, std::vector<Particle> &particles) {
+    TaskPool &pool = TaskPool::global();
+    balancer.partition(tree.spatialOrder(), particles.size(), pool.threadCount());
+    pool.parallelFor(0, balancer.chunkCount(), 1, [&](std::size_t chunk) {
+        double start = omp_get_wtime();
+        for (std::size_t k = balancer.chunkBegin(chunk); k < balancer.chunkEnd(chunk); k++) {
+            uint32_t index = balancer.particleAt(k);
+            uint32_t interactions;
+            particles[index].resetAcceleration();
+            particles[index].addAcceleration(tree.computeAcceleration(particles[index], interactions));
+            balancer.setCost(index, interactions);
+        }
+        balancer.setChunkTime(chunk, omp_get_wtime() - start);
+    });
+}
+
 // Initialisation aléatoire des particules en 3D
 std::vector<Particle> initParticles(int N) {
     std::vector<Particle> particles;
@@ -56,7 +160,9 @@ std::vector<Particle> initParticles(int N) {
 }
 
 int main(int argc, char *argv[]) {
-    omp_set_num_threads(std::max(1, omp_get_max_threads() - 4)); // Laisse 2 threads libres pour l'API et le système
+#ifdef USE_MPI
+    MpiEnvironment mpi(argc, argv);
+#endif
     namespace po = boost::program_options;
     int N;
     bool display;
@@ -64,6 +170,25 @@ int main(int argc, char *argv[]) {
     float simulMaxTime;
     int portAPI;
     bool pausedD;
+    bool planar;
+    std::string solver;
+    std::string octreeTraversal;
+    std::string kdSplit;
+    int kdLeafCapacity;
+    int fmmOrder;
+    float fmmTheta;
+    int fmmLeafCapacity;
+    int reuseLists;
+    float listMargin;
+    int listGroup;
+    std::string balance;
+    bool balanceReport;
+    bool stepReport;
+    bool arenaReport;
+    int nbThreads;
+    std::string affinity;
+    std::string apiCores;
+    SessionLimits sessionLimits;
     po::options_description desc("Options autorisées");
     desc.add_options()
         ("help,h", "affiche ce message d'aide")
@@ -71,6 +196,28 @@ int main(int argc, char *argv[]) {
         ("particles", po::value<int>(&N)->required(), "nombre de particules")
         ("pausedAtStart", po::value<bool>(&pausedD)->default_value(false), "simulation en pause au démarrage (true/false)")
         ("simulTime", po::value<float>(&simulMaxTime)->default_value(50.0f), "durée de la simulation en secondes (-1 pour infini)")
+        ("planar", po::value<bool>(&planar)->default_value(false), "mode 2D pour les systèmes quasi plans : quadtree et intégration (x, y) (true/false)")
+        ("solver", po::value<std::string>(&solver)->default_value("octree"), "solveur de gravité en 3D (octree/kdtree/fmm)")
+        ("octree-traversal", po::value<std::string>(&octreeTraversal)->default_value("stackless"), "parcours de l'octree (stackless/wide : nœuds larges SIMD)")
+        ("kd-split", po::value<std::string>(&kdSplit)->default_value("median"), "règle de coupe de l'arbre kd (median/sah)")
+        ("kd-leaf", po::value<int>(&kdLeafCapacity)->default_value(8), "nombre maximal de particules par feuille de l'arbre kd")
+        ("fmm-order", po::value<int>(&fmmOrder)->default_value(4), "ordre p des développements FMM (modifiable via /settings)")
+        ("fmm-theta", po::value<float>(&fmmTheta)->default_value(0.7f), "critère d'ouverture de la traversée FMM")
+        ("fmm-leaf", po::value<int>(&fmmLeafCapacity)->default_value(32), "nombre maximal de particules par feuille du FMM")
+        ("reuse-lists", po::value<int>(&reuseLists)->default_value(0), "octree : nombre de pas maximal sur les mêmes listes d'interaction (0 : désactivé)")
+        ("list-margin", po::value<float>(&listMargin)->default_value(0.005f), "marge des listes d'interaction, relative à la taille du volume")
+        ("list-group", po::value<int>(&listGroup)->default_value(32), "nombre maximal de particules par groupe partageant une liste")
+        ("balance", po::value<std::string>(&balance)->default_value("costzones"), "répartition des particules de l'octree entre threads (costzones/static)")
+        ("balance-report", po::value<bool>(&balanceReport)->default_value(false), "affiche le déséquilibre de charge à chaque pas (true/false)")
+        ("step-report", po::value<bool>(&stepReport)->default_value(false), "affiche la chronologie des phases de chaque pas (true/false)")
+        ("arena-report", po::value<bool>(&arenaReport)->default_value(false), "affiche le placement NUMA et en pages larges des tableaux après le premier pas (true/false)")
+        ("threads", po::value<int>(&nbThreads)->default_value(0), "nombre de threads de simulation (0 : tous les cœurs moins 4, modifiable via /settings)")
+        ("affinity", po::value<std::string>(&affinity)->default_value("none"), "placement des threads de simulation (none/compact/scatter/liste de cœurs \"0,2,4-7\")")
+        ("api-cores", po::value<std::string>(&apiCores)->default_value(""), "cœurs réservés à l'API REST et aux entrées/sorties, retirés de la simulation (ex. \"0-1\")")
+        ("max-sessions", po::value<int>(&sessionLimits.maxSessions)->default_value(16), "nombre maximal de sessions servies sous /sessions/{id}/... (0 : désactivées)")
+        ("session-particles", po::value<int>(&sessionLimits.maxParticles)->default_value(100000), "nombre maximal de particules par session")
+        ("session-history", po::value<float>(&sessionLimits.maxHistory)->default_value(60.f), "durée maximale de l'historique d'une session, en secondes")
+        ("session-idle", po::value<float>(&sessionLimits.idleTimeout)->default_value(300.f), "suspension d'une session sans requête depuis ce délai, en secondes (0 : jamais)")
         ("display", po::value<bool>(&display)->default_value(false), "fenètre d'affichage SFML (true/false)")
         ("drawOctreeBorders", po::value<bool>(&drawOctreeBorders)->default_value(true), "afficher les bords de l'octree (true/false)");
     po::positional_options_description p;
@@ -83,51 +230,194 @@ int main(int argc, char *argv[]) {
             return 0;
         }
         po::notify(vm);
+        if (solver != "octree" && solver != "kdtree" && solver != "fmm")
+            throw po::validation_error(po::validation_error::invalid_option_value, "solver", solver);
+        if (octreeTraversal != "stackless" && octreeTraversal != "wide")
+            throw po::validation_error(po::validation_error::invalid_option_value, "octree-traversal", octreeTraversal);
+        if (kdSplit != "median" && kdSplit != "sah")
+            throw po::validation_error(po::validation_error::invalid_option_value, "kd-split", kdSplit);
+        if (balance != "costzones" && balance != "static")
+            throw po::validation_error(po::validation_error::invalid_option_value, "balance", balance);
+#ifdef USE_MPI
+        if (planar || display || solver != "octree" || reuseLists > 0)
+            throw po::error("mode MPI : seul le solveur octree 3D sans affichage est réparti");
+#endif
     }
     catch (const po::error &ex) {
         std::cerr << ex.what() << "\n";
         return 1;
     }
 
+    // Placement des threads : la simulation épingle ses threads, l'API reste sur ses cœurs réservés
+    ThreadTopology topology;
+    try {
+        topology.setApiCores(apiCores);
+        topology.setAffinity(affinity);
+    }
+    catch (const std::invalid_argument &ex) {
+        std::cerr << ex.what() << "\n";
+        return 1;
+    }
+    if (nbThreads <= 0)
+        nbThreads = std::max(1, omp_get_max_threads() - 4); // Laisse des threads libres pour l'API et le système
+    topology.apply(nbThreads);
+    if (affinity != "none") {
+        printf("%d threads de simulation (%s) :", nbThreads, affinity.c_str());
+        for (int i = 0; i < nbThreads; i++)
+            printf(" %d", topology.cpuForThread(i));
+        printf("\n");
+    }
+
+#ifdef USE_MPI
+    // Les rangs autres que 0 calculent leur part de chaque pas ; le rang 0 pilote et sert l'API
+    DistributedSimulation distributed(MPI_COMM_WORLD);
+    if (distributed.rank() != 0) {
+        distributed.serve();
+        return 0;
+    }
+#endif
+
     // Initialisation des particules
     std::vector<Particle> particles = initParticles(N);
 
     // Paramètres de simulation partagés
-    SimulationSettings settings{simulMaxTime, 0.5, N, 0.f, 40.0f, false, Y_MAX, X_MAX, Z_MAX, Y_MIN, X_MIN, Z_MIN, -1};
+    SimulationSettings settings{simulMaxTime, 0.5, N, 0.f, 40.0f, false, Y_MAX, X_MAX, Z_MAX, Y_MIN, X_MIN, Z_MIN, -1, fmmOrder, 1.f, nbThreads, affinity};
     std::mutex mtx;
-    std::atomic<bool> paused(pausedD);
-    std::atomic<bool> closed(false);
 
     // Initialisation de l'octree
     Octree tree(X_MIN, Y_MIN, Z_MIN, X_MAX - X_MIN, Y_MAX - Y_MIN, Z_MAX - Z_MIN, 1);
+    tree.setWideTraversal(octreeTraversal == "wide");
+    // Quadtree utilisé à la place de l'octree en mode 2D
+    Quadtree qtree(X_MIN, Y_MIN, X_MAX - X_MIN, Y_MAX - Y_MIN, 1);
+    // Arbre kd utilisé à la place de l'octree pour les distributions très anisotropes
+    KdTree kdtree(kdLeafCapacity, kdSplit == "sah" ? KdTree::SURFACE_AREA : KdTree::MEDIAN);
+    // FMM (O(N)) pour les très grands nombres de particules
+    FMMSolver fmm(fmmOrder, fmmTheta, fmmLeafCapacity);
+    // Listes d'interaction de l'octree réutilisées tant que les particules restent dans la marge
+    InteractionCache lists(reuseLists, listMargin, listGroup);
+    // Découpage par coût de la boucle des forces de l'octree
+    LoadBalancer balancer;
 
-    // Lancer le serveur REST
-    APIRest api(tree, particles, settings, paused, mtx);
-    api.start(portAPI);
-
-    if (!display) {
-        printf("Simulation en mode headless pour %f secondes avec %d particules...\n", settings.t_total, N);
-        while ((settings.current_time < settings.t_total || settings.t_total == -1) && !settings.closed) {
-            if (!paused) {
-                tree.clear();
-                for (const auto &p : particles) {
-                    tree.insert(&p);
-                }
+    // Historique des états par pas (rembobinage et trajectoires servies par l'API)
+    HistoryBuffer history;
+    // Instantanés publiés pour l'API à chaque pas
+    SnapshotPublisher snapshots;
+    snapshots.publishParticles(particles, settings, history);
+#ifndef USE_MPI
+    // Pas local (la version MPI a son propre pas, plus bas)
+    SimulationState simulation{particles, settings, mtx, history, snapshots};
+    // Graphe des phases d'un pas sur le pool de tâches
+    StepPipeline pipeline(TaskPool::global());
 
-                // Pas besoin de lock supplémentaire ici : chaque thread modifie une Particle différente
-                #pragma omp parallel for 
-                for (auto &p : particles) {
-                    updateParticleState(p, tree, settings.dt);
-                    p.saveState(settings.current_time, settings.rewind_max_history, mtx);
+    // Un pas de simulation avec le solveur choisi pour ce run
+    auto step = [&]() {
+        float time = settings.current_time;
+        if (planar) {
+            pipeline.run(stepPhases(qtree, simulation, time));
+        } else if (solver == "kdtree") {
+            pipeline.run(stepPhases(kdtree, simulation, time));
+        } else if (solver == "fmm") {
+            // L'ordre peut être changé en cours de simulation via POST /settings
+            fmm.setOrder(settings.fmm_order);
+            pipeline.run(stepPhases(fmm, simulation, time));
+        } else if (reuseLists > 0) {
+            pipeline.run(stepPhases(lists, simulation, time));
+        } else if (balance == "costzones") {
+            StepPipeline::Phases phases = stepPhases(tree, simulation, time);
+            // Déséquilibre relevé à la fin de la force, publié avec le pas (le balancer sert déjà au pas suivant)
+            std::shared_ptr<float> imbalance = std::make_shared<float>(1.f);
+            phases.force = [&tree, &balancer, &particles, imbalance]() {
+                balancedForce(tree, balancer, particles);
+                *imbalance = static_cast<float>(balancer.imbalance());
+            };
+            std::function<void()> publishStep = phases.publish;
+            phases.publish = [&settings, &mtx, imbalance, publishStep]() {
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    settings.load_imbalance = *imbalance;
                 }
-                std::lock_guard<std::mutex> lock(mtx);
-                settings.current_time += settings.dt;
+                publishStep();
+            };
+            pipeline.run(phases);
+            if (balanceReport)
+                printf("t = %.2f : déséquilibre %.3f (prévu %.3f, %d threads)\n", time,
+                       balancer.imbalance(), balancer.predictedImbalance(), balancer.chunkCount());
+        } else {
+            pipeline.run(stepPhases(tree, simulation, time));
+        }
+        if (stepReport) {
+            printf("t = %.2f :\n", time);
+            pipeline.printTimeline();
+        }
+        if (arenaReport) {
+            arenaReport = false;
+            pipeline.flush();
+            std::vector<Arena::Region> regions;
+            if (!planar && solver == "octree" && reuseLists <= 0)
+                regions = tree.arenaRegions();
+            std::shared_ptr<const HistoryView> frames = history.view();
+            if (!frames->empty()) {
+                const HistoryFrame &frame = *frames->back();
+                regions.push_back({"history.x", frame.x.data(), frame.x.size() * sizeof(float)});
+                regions.push_back({"history.vx", frame.vx.data(), frame.vx.size() * sizeof(float)});
             }
+            Arena::printReport(regions);
+        }
+    };
+#endif
 
-            while (!settings.closed && settings.current_time >= settings.t_total && settings.t_total != -1) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            }
+#ifdef USE_MPI
+    // Pas réparti sur les rangs ; l'état global du rang 0 est redistribué après les commandes de l'API
+    bool reloadState = true;
+    auto runStep = [&]() {
+        float time = settings.current_time;
+        distributed.step(particles, settings.dt, reloadState);
+        reloadState = false;
+        history.record(particles, time, settings.rewind_max_history);
+        SimulationSettings published = settings;
+        published.current_time = time + settings.dt;
+        snapshots.publishStep(particles, published, history);
+        if (stepReport) {
+            printf("t = %.2f :\n", time);
+            distributed.printReport();
         }
+    };
+    auto settleStep = [&reloadState]() { reloadState = true; };
+#else
+    auto &runStep = step;
+    auto settleStep = [&pipeline]() { pipeline.flush(); };
+#endif
+
+    // Seul le thread de simulation modifie l'état : l'API dépose ses commandes, appliquées entre deux pas
+    SimulationController controller(
+        [&]() {
+            runStep();
+            std::lock_guard<std::mutex> lock(mtx);
+            settings.current_time += settings.dt;
+        },
+        [&settings]() { return settings.t_total == -1 || settings.current_time < settings.t_total; },
+        settleStep,
+        pausedD);
+
+    // Sessions indépendantes, avancées à tour de rôle sur le même pool de tâches
+    SessionManager sessions(sessionLimits, settings);
+    if (sessionLimits.maxSessions > 0)
+        sessions.start();
+
+    // Lancer le serveur REST
+    APIRest api(tree, particles, history, snapshots, settings, controller, topology, sessionLimits.maxSessions > 0 ? &sessions : nullptr);
+    api.start(portAPI);
+
+    if (!display) {
+        printf("Simulation en mode headless (%s, %s) pour %f secondes avec %d particules...\n", planar ? "2D" : "3D", planar ? "quadtree" : solver.c_str(), settings.t_total, N);
+#ifdef USE_MPI
+        printf("Répartition sur %d processus MPI\n", distributed.size());
+#endif
+        // En pause ou une fois la durée atteinte, attend les commandes jusqu'à POST /stop
+        controller.run();
+#ifdef USE_MPI
+        distributed.stop();
+#endif
     }
 
     #ifdef DISPLAY_VERSION
@@ -149,9 +439,7 @@ int main(int argc, char *argv[]) {
         float fov = 60.f; // Champ de vision (zoom)
 
         float simulationTime = 0.f;
-        for (const auto &p : particles) {
-            tree.insert(&p);
-        }
+        tree.build(particles);
 
         // Boucle principale
         while (window.isOpen()) {
@@ -207,21 +495,9 @@ int main(int argc, char *argv[]) {
                 }
             }
 
-            // Mise à jour de la simulation
-            if (!paused) {
-                tree.clear();
-                for (const auto &p : particles) {
-                    tree.insert(&p);
-                }
-                #pragma omp parallel for 
-                for (auto &p : particles) {
-                    updateParticleState(p, tree, settings.dt);
-                    p.saveState(settings.current_time, settings.rewind_max_history, mtx);
-                }
-                settings.current_time += settings.dt;
-                if (simulationTime > settings.t_total)
-                    simulationTime = 0.f;
-            }
+            // Mise à jour de la simulation (commandes de l'API appliquées avant le pas)
+            if (!controller.poll())
+                window.close();
 
             // Configuration de la vue OpenGL
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -237,18 +513,34 @@ int main(int argc, char *argv[]) {
                 p.drawGL();
             }
             // Affichage de l'octree si demandé
-            if (drawOctreeBorders)
-                tree.drawGL();
+            if (drawOctreeBorders) {
+                if (planar)
+                    qtree.drawGL(0.5f * (Z_MIN + Z_MAX));
+                else if (solver == "kdtree")
+                    kdtree.drawGL();
+                else if (solver == "fmm")
+                    fmm.drawGL();
+                else if (reuseLists > 0)
+                    lists.drawGL();
+                else
+                    tree.drawGL();
+            }
 
             window.display();
             sf::sleep(sf::milliseconds(10));
         }
+        // Fenêtre fermée : plus aucun poll(), les commandes en attente ou à venir s'exécutent directement
+        // (sinon les requêtes en cours attendraient sans fin et api.stop() ne pourrait pas les joindre)
+        controller.setStopped();
+        controller.detach();
     }
 
     #endif
 
+    sessions.stop();
     api.stop();
     // Nettoyage de l'octree
     Octree::clearInstances();
+    Quadtree::clearInstances();
     return 0;
 }
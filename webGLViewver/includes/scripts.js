@@ -23,6 +23,9 @@ const mouse = new THREE.Vector2();
 let hoveredParticleId = null;
 let selectedParticleId = null;
 let latestParticlesData = [];
+let particlesVersion = null; // Version de l'état reçu, renvoyée dans GET /particles?since=
+let particlesStream = null; // Flux SSE des trames (GET /stream), à la place de l'interrogation périodique
+let streamBaseVersion = null; // Dernière discontinuité (chargement, rembobinage, reset) vue sur le flux
 let trailLine = null;
 
 let mediaRecorder = null;
@@ -168,7 +171,51 @@ function updatePauseButton(paused) {
     checkIfIntervalUpdateNeedToRegister();
 }
 
+// Ouvre le flux des trames ; faux si le navigateur ne gère pas les Server-Sent Events
+function openStream() {
+    if (!window.EventSource) return false;
+    particlesStream = new EventSource('/api/stream');
+    particlesStream.addEventListener('frame', e => {
+        const frame = JSON.parse(e.data);
+        applySettings(frame.settings);
+        const data = latestParticlesData;
+        if (frame.base_version !== streamBaseVersion || data.length !== frame.x.length) {
+            // Nouvel ensemble de particules : état complet (noms, masses, historique)
+            streamBaseVersion = frame.base_version;
+            particlesVersion = null;
+            fetchParticles();
+            return;
+        }
+        const settings = frame.settings;
+        const maxHistory = settings.rewind_max_history === -1 ? Infinity : Math.round(settings.rewind_max_history / settings.dt) + 1;
+        data.forEach((p, i) => {
+            p.x = frame.x[i];
+            p.y = frame.y[i];
+            p.z = frame.z[i];
+            p.vx = frame.vx[i];
+            p.vy = frame.vy[i];
+            p.vz = frame.vz[i];
+            p.history.push({ x: p.x, y: p.y, z: p.z });
+            if (p.history.length > maxHistory)
+                p.history.splice(0, p.history.length - maxHistory);
+        });
+        showParticles(data);
+    });
+    particlesStream.addEventListener('settings', e => applySettings(JSON.parse(e.data).settings));
+    particlesStream.onerror = () => {
+        // Flux refusé ou coupé : retour à l'interrogation périodique
+        particlesStream.close();
+        particlesStream = null;
+        if (!particlesInterval) particlesInterval = setInterval(fetchParticles, 200);
+    };
+    return true;
+}
+
 function clearIntervals() {
+    if (particlesStream) {
+        particlesStream.close();
+        particlesStream = null;
+    }
     if (particlesInterval) {
         clearInterval(particlesInterval);
         particlesInterval = null;
@@ -179,7 +226,7 @@ function clearIntervals() {
     }
 }
 function setIntervals() {
-    if (!particlesInterval) {
+    if (!particlesInterval && !particlesStream && !openStream()) {
         particlesInterval = setInterval(fetchParticles, 200);
     }
     if (!settingsInterval) {
@@ -195,93 +242,134 @@ function checkIfIntervalUpdateNeedToRegister() {
     }
 }
 
+// Ajoute les trames reçues (GET /particles?since=) à l'historique des particules déjà connues
+function applyParticlesDelta(delta) {
+    const data = latestParticlesData;
+    delta.frames.forEach(frame => {
+        data.forEach((p, i) => {
+            p.x = frame.x[i];
+            p.y = frame.y[i];
+            p.z = frame.z[i];
+            p.history.push({ x: p.x, y: p.y, z: p.z });
+        });
+    });
+    data.forEach((p, i) => {
+        if (p.history.length > delta.history_length)
+            p.history.splice(0, p.history.length - delta.history_length);
+        p.vx = delta.vx[i];
+        p.vy = delta.vy[i];
+        p.vz = delta.vz[i];
+    });
+    return data;
+}
+
 function fetchParticles() {
-    fetch('/api/particles').then(r=>r.json()).then(data=>{
-        // Update particle list
-        updateParticleList(data);
-        // Calcul de la taille d'affichage pour chaque particule (une seule fois)
-        if (!data[0]?.displaySize) {
-            //  Calcule la taille brute pour chaque particule
-            const rawSizes = data.map(p =>
-                Math.cbrt((p.mass || 1) / (p.masseVolumique || 1))
-            );
-            // Trouve la taille brute maximale
-            const maxRawSize = Math.max(...rawSizes, 1);
-            //  Taille max d'affichage
-            const maxDisplaySize = 15;
-            const minDisplaySize = 5;
-            data.forEach((p, i) => {
-                // Taille relative, mais toujours la même pour chaque id
-                p.displaySize = minDisplaySize + (rawSizes[i] / maxRawSize) * (maxDisplaySize - minDisplaySize);
-            });
-        }
-        latestParticlesData = data;
-        updateParticles(data);
-        updateTrail(); 
+    const url = particlesVersion === null ? '/api/particles' : '/api/particles?since=' + particlesVersion;
+    fetch(url).then(r => {
+        // 304 : rien n'a changé depuis la version reçue
+        if (r.status === 304) return null;
+        const version = r.headers.get('X-Snapshot-Version');
+        return r.json().then(body => {
+            particlesVersion = version;
+            return body;
+        });
+    }).then(body => {
+        if (body === null) return;
+        // Tableau : état complet ; objet : trames ajoutées depuis particlesVersion
+        showParticles(Array.isArray(body) ? body : applyParticlesDelta(body));
     });
 }
 
+function showParticles(data) {
+    // Update particle list
+    updateParticleList(data);
+    // Calcul de la taille d'affichage pour chaque particule (une seule fois)
+    if (!data[0]?.displaySize) {
+        //  Calcule la taille brute pour chaque particule
+        const rawSizes = data.map(p =>
+            Math.cbrt((p.mass || 1) / (p.masseVolumique || 1))
+        );
+        // Trouve la taille brute maximale
+        const maxRawSize = Math.max(...rawSizes, 1);
+        //  Taille max d'affichage
+        const maxDisplaySize = 15;
+        const minDisplaySize = 5;
+        data.forEach((p, i) => {
+            // Taille relative, mais toujours la même pour chaque id
+            p.displaySize = minDisplaySize + (rawSizes[i] / maxRawSize) * (maxDisplaySize - minDisplaySize);
+        });
+    }
+    latestParticlesData = data;
+    updateParticles(data);
+    updateTrail(); 
+}
+
 
 function fetchSettings() {
-    fetch('/api/settings').then(r=>r.json()).then(data=>{
-        document.getElementById('dt_current').textContent = data.dt;
-        document.getElementById('dt_current').title = "Delta Time (dt) : " + data.dt;
-        document.getElementById('t_total_current').textContent = data.t_total;
-        document.getElementById('t_total_current').title = "Temps total de la simulation (t_total) : " + data.t_total;
-        document.getElementById('nb_particles_current').textContent = data.nb_particles;
-        document.getElementById('nb_particles_current').title = "Nombre de particules (nb_particles) : " + data.nb_particles;
-        document.getElementById('current_time_current').textContent = data.current_time;
-        document.getElementById('current_time_current').title = "Temps actuel de la simulation (current_time) : " + data.current_time;
-        
-        document.getElementById('dt_input').placeholder = data.dt;
-        document.getElementById('t_total_input').placeholder = data.t_total;
-        document.getElementById('nb_particles_input').placeholder = data.nb_particles;
-        document.getElementById('current_time_input').placeholder = data.current_time;
-        document.getElementById('history_resolution_current').textContent = data.history_resolution ?? "Tout";
-        document.getElementById('history_resolution_current').title = "Nombre de points d'historique envoyés au client";
-        document.getElementById('history_resolution_input').placeholder = data.history_resolution ?? "Tout";
-        
-        // Update box overlay fields
-        for (const key of ["MIN_X", "MIN_Y", "MIN_Z", "MAX_X", "MAX_Y", "MAX_Z"]) {
-            if (data[key] !== undefined) {
-                document.getElementById(key + "_current").textContent = data[key];
-                document.getElementById(key + "_current").title = key + " : " + data[key];
-                document.getElementById(key + "_input").placeholder = data[key];
-            }
+    fetch('/api/settings').then(r=>r.json()).then(applySettings);
+}
+
+// Paramètres reçus de GET /settings ou du flux (sans l'état de pause)
+function applySettings(data) {
+    document.getElementById('dt_current').textContent = data.dt;
+    document.getElementById('dt_current').title = "Delta Time (dt) : " + data.dt;
+    document.getElementById('t_total_current').textContent = data.t_total;
+    document.getElementById('t_total_current').title = "Temps total de la simulation (t_total) : " + data.t_total;
+    document.getElementById('nb_particles_current').textContent = data.nb_particles;
+    document.getElementById('nb_particles_current').title = "Nombre de particules (nb_particles) : " + data.nb_particles;
+    document.getElementById('current_time_current').textContent = data.current_time;
+    document.getElementById('current_time_current').title = "Temps actuel de la simulation (current_time) : " + data.current_time;
+    
+    document.getElementById('dt_input').placeholder = data.dt;
+    document.getElementById('t_total_input').placeholder = data.t_total;
+    document.getElementById('nb_particles_input').placeholder = data.nb_particles;
+    document.getElementById('current_time_input').placeholder = data.current_time;
+    document.getElementById('history_resolution_current').textContent = data.history_resolution ?? "Tout";
+    document.getElementById('history_resolution_current').title = "Nombre de points d'historique envoyés au client";
+    document.getElementById('history_resolution_input').placeholder = data.history_resolution ?? "Tout";
+    
+    // Update box overlay fields
+    for (const key of ["MIN_X", "MIN_Y", "MIN_Z", "MAX_X", "MAX_Y", "MAX_Z"]) {
+        if (data[key] !== undefined) {
+            document.getElementById(key + "_current").textContent = data[key];
+            document.getElementById(key + "_current").title = key + " : " + data[key];
+            document.getElementById(key + "_input").placeholder = data[key];
         }
-        if (data.MIN_X !== undefined && data.MIN_Y !== undefined && data.MIN_Z !== undefined &&
-            data.MAX_X !== undefined && data.MAX_Y !== undefined && data.MAX_Z !== undefined) {
-            // Only update if the box size has changed
-            if (
-            realBoxSize.xMin !== data.MIN_X ||
-            realBoxSize.yMin !== data.MIN_Y ||
-            realBoxSize.zMin !== data.MIN_Z ||
-            realBoxSize.xMax !== data.MAX_X ||
-            realBoxSize.yMax !== data.MAX_Y ||
-            realBoxSize.zMax !== data.MAX_Z
-            ) {
-            realBoxSize = {
-                xMin: data.MIN_X,
-                yMin: data.MIN_Y,
-                zMin: data.MIN_Z,
-                xMax: data.MAX_X,
-                yMax: data.MAX_Y,
-                zMax: data.MAX_Z
-            };
-            updateSimBox(realBoxSize);
-            
-            }
+    }
+    if (data.MIN_X !== undefined && data.MIN_Y !== undefined && data.MIN_Z !== undefined &&
+        data.MAX_X !== undefined && data.MAX_Y !== undefined && data.MAX_Z !== undefined) {
+        // Only update if the box size has changed
+        if (
+        realBoxSize.xMin !== data.MIN_X ||
+        realBoxSize.yMin !== data.MIN_Y ||
+        realBoxSize.zMin !== data.MIN_Z ||
+        realBoxSize.xMax !== data.MAX_X ||
+        realBoxSize.yMax !== data.MAX_Y ||
+        realBoxSize.zMax !== data.MAX_Z
+        ) {
+        realBoxSize = {
+            xMin: data.MIN_X,
+            yMin: data.MIN_Y,
+            zMin: data.MIN_Z,
+            xMax: data.MAX_X,
+            yMax: data.MAX_Y,
+            zMax: data.MAX_Z
+        };
+        updateSimBox(realBoxSize);
+        
         }
-        // Update pause state
+    }
+    // Update pause state
+    if (data.paused !== undefined) {
         paused = data.paused;
         updatePauseButton(paused);
+    }
 
-        // Synchronisation des champs rewind
-        const rewindMaxHistoryInput = document.getElementById('rewind_max_history_input');
-        if (rewindMaxHistoryInput && document.activeElement !== rewindMaxHistoryInput) {
-            rewindMaxHistoryInput.value = data.rewind_max_history ?? 5;
-        }
-    });
+    // Synchronisation des champs rewind
+    const rewindMaxHistoryInput = document.getElementById('rewind_max_history_input');
+    if (rewindMaxHistoryInput && document.activeElement !== rewindMaxHistoryInput) {
+        rewindMaxHistoryInput.value = data.rewind_max_history ?? 5;
+    }
 }
     
 // Event listeners for settings overlay submission
@@ -874,5 +962,5 @@ fetchParticles();
 renderer.domElement.addEventListener('mousemove', onPointerMove);
 renderer.domElement.addEventListener('click', onPointerClick);
 // Set intervals for periodic updates
-particlesInterval = setInterval(fetchParticles, 1000 / 30);
+if (!openStream()) particlesInterval = setInterval(fetchParticles, 1000 / 30);
 settingsInterval = setInterval(fetchSettings, 1000);
\ No newline at end of file
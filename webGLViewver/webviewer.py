@@ -1,4 +1,4 @@
-from flask import Flask, render_template, request, jsonify, send_from_directory, abort
+from flask import Flask, Response, render_template, request, jsonify, send_from_directory, abort
 import requests
 import logging
 import os
@@ -37,6 +37,12 @@ def includes_files(namefile):
     else:
         abort(404)
 
+# En-tête de requête conditionnelle du navigateur (réponses mises en cache par le serveur de calcul)
+def conditional_headers():
+    if "If-None-Match" in request.headers:
+        return {"If-None-Match": request.headers["If-None-Match"]}
+    return {}
+
 @app.route("/api/particles", methods=["GET", "POST"])
 def api_particles():
     if request.method == "POST":
@@ -44,8 +50,30 @@ def api_particles():
         requests.post(f"{API_URL}/particles", json=data)
         return "", 204
     else:
-        r = requests.get(f"{API_URL}/particles")
-        return jsonify(r.json())
+        # since (état incrémental) et If-None-Match transmis tels quels ; 304, ETag et version de l'état relayés au navigateur
+        r = requests.get(f"{API_URL}/particles", params=request.args, headers=conditional_headers())
+        headers = {"Content-Type": "application/json"}
+        for name in ("X-Snapshot-Version", "ETag"):
+            if name in r.headers:
+                headers[name] = r.headers[name]
+        return (r.content, r.status_code, headers)
+
+@app.route("/api/particles.bin", methods=["GET"])
+def api_particles_bin():
+    # Relais direct des octets (colonnes float32, voir GET /particles.bin)
+    r = requests.get(f"{API_URL}/particles.bin", headers=conditional_headers())
+    headers = {"Content-Type": "application/octet-stream"}
+    if "ETag" in r.headers:
+        headers["ETag"] = r.headers["ETag"]
+    return (r.content, r.status_code, headers)
+
+@app.route("/api/stream", methods=["GET"])
+def api_stream():
+    # Relais du flux SSE morceau par morceau, sans mise en mémoire tampon
+    r = requests.get(f"{API_URL}/stream", params=request.args, stream=True)
+    if r.status_code != 200:
+        return "", r.status_code
+    return Response(r.iter_content(chunk_size=None), content_type="text/event-stream", headers={"Cache-Control": "no-cache"})
 
 @app.route("/api/settings", methods=["GET", "POST"])
 def api_settings():